@@ -0,0 +1,166 @@
+// Routing benchmark on a synthetic city grid.
+// Usage: route_bench [side=100] [queries=200]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include "dijkstra.hpp"
+#include "ch.hpp"
+#include "cch.hpp"
+#include "alt.hpp"
+#include "matrix.hpp"
+#include "pqueue.hpp"
+
+// side x side grid with two-way streets of 1..10 minutes; every tenth row and
+// column is a fast arterial (1..2 minutes per block)
+static Graph build_city_grid(int side, std::mt19937& rng) {
+    int n = side * side;
+    GraphBuilder b(n);
+    std::uniform_int_distribution<int> street(1, 10), arterial(1, 2);
+    auto id = [side](int r, int c) { return r * side + c; };
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            if (c + 1 < side) {
+                auto& d = (r % 10 == 0) ? arterial : street;
+                b.add_edge(id(r, c), id(r, c + 1), d(rng));
+                b.add_edge(id(r, c + 1), id(r, c), d(rng));
+            }
+            if (r + 1 < side) {
+                auto& d = (c % 10 == 0) ? arterial : street;
+                b.add_edge(id(r, c), id(r + 1, c), d(rng));
+                b.add_edge(id(r + 1, c), id(r, c), d(rng));
+            }
+        }
+    }
+    return b.build();
+}
+
+template <typename F>
+static double time_us(F&& f) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int side = argc > 1 ? std::atoi(argv[1]) : 100;
+    int queries = argc > 2 ? std::atoi(argv[2]) : 200;
+    std::mt19937 rng(42);
+    Graph g = build_city_grid(side, rng);
+    std::cout << "graph: " << g.n << " nodes, " << g.edge_count() << " edges\n";
+
+    ContractionHierarchy ch;
+    double build_us = time_us([&] { ch = ContractionHierarchy::build(g); });
+    std::cout << "ch build: " << build_us / 1000.0 << " ms, " << ch.shortcut_count() << " shortcuts\n";
+
+    CustomizableCH cch;
+    double cch_build_us = time_us([&] { cch = CustomizableCH::build(g); });
+    // incident-style metric: triple the cost of every edge around a few hundred nodes
+    EdgeWeights adjusted(g.edge_count());
+    for (int i = 0; i < g.edge_count(); ++i) adjusted[i] = g.edges[i].w;
+    std::uniform_int_distribution<int> pick(0, g.n - 1);
+    for (int k = 0; k < 300; ++k) {
+        int v = pick(rng);
+        for (int i = g.offsets[v]; i < g.offsets[v + 1]; ++i) adjusted[i] *= 3;
+        for (const auto& ie : g.in(v)) adjusted[ie.id] *= 3;
+    }
+    UpwardGraph metric;
+    double customize_us = time_us([&] { metric = cch.customize(adjusted); });
+    std::cout << "cch build: " << cch_build_us / 1000.0 << " ms, " << cch.arc_count() << " arcs; customize: "
+        << customize_us / 1000.0 << " ms\n";
+
+    Landmarks lm;
+    double lm_build_us = time_us([&] { lm = Landmarks::build(g, 16); });
+    std::cout << "landmarks: " << lm.count() << " in " << lm_build_us / 1000.0 << " ms\n";
+
+    double t_dij = 0, t_targets = 0, t_p2p = 0, t_ch = 0, t_adj = 0, t_cch = 0, t_alt = 0;
+    long long settled_dij = 0, settled_ch = 0, settled_cch = 0, settled_alt = 0;
+    int mismatches = 0;
+    for (int q = 0; q < queries; ++q) {
+        int s = pick(rng), t = pick(rng);
+        DijkstraResult a;
+        RouteResult b, c;
+        std::vector<RouteResult> many;
+        int ch_settled = 0;
+        t_dij += time_us([&] { a = dijkstra(g, s); });
+        t_targets += time_us([&] { many = route_to_targets(g, s, { t, pick(rng), pick(rng), pick(rng) }); });
+        if (many[0].dist != a.dist[t]) ++mismatches;
+        t_p2p += time_us([&] { b = route_p2p(g, s, t); });
+        t_ch += time_us([&] { c = ch.route(s, t, &ch_settled); });
+        for (long long d : a.dist) if (d != INF) ++settled_dij;   // one-to-all settles everything reachable
+        settled_ch += ch_settled;
+        if (a.dist[t] != b.dist || a.dist[t] != c.dist) ++mismatches;
+
+        RouteResult d, e;
+        int cch_settled = 0;
+        t_adj += time_us([&] { d = route_p2p(g, s, t, adjusted); });
+        t_cch += time_us([&] { e = upward_route(metric, s, t, &cch_settled); });
+        settled_cch += cch_settled;
+        if (d.dist != e.dist) ++mismatches;
+
+        RouteResult f;
+        int alt_settled = 0;
+        t_alt += time_us([&] { f = astar_route(g, s, t, lm, adjusted, &alt_settled); });
+        settled_alt += alt_settled;
+        if (d.dist != f.dist) ++mismatches;
+    }
+
+    std::cout << "engine        avg_us     avg_settled\n";
+    std::cout << "dijkstra      " << t_dij / queries << "     " << settled_dij / queries << "\n";
+    std::cout << "to 4 targets  " << t_targets / queries << "\n";
+    std::cout << "route_p2p     " << t_p2p / queries << "\n";
+    std::cout << "ch            " << t_ch / queries << "     " << settled_ch / queries << "\n";
+    std::cout << "adjusted metric:\n";
+    std::cout << "route_p2p     " << t_adj / queries << "\n";
+    std::cout << "cch           " << t_cch / queries << "     " << settled_cch / queries << "\n";
+    std::cout << "alt           " << t_alt / queries << "     " << settled_alt / queries << "\n";
+
+    // queue policies for the one-to-all engine, on baseline and adjusted weights
+    std::cout << "queue policy  avg_us(base)  avg_us(adjusted)\n";
+    auto bench_queue = [&](const char* name, auto tag) {
+        using Queue = decltype(tag);
+        std::mt19937 qrng(7);
+        double tb = 0, ta = 0;
+        for (int q = 0; q < queries; ++q) {
+            int s = pick(qrng);
+            DijkstraResult ref = dijkstra_with<BinaryHeapQueue>(g, s, adjusted), r, r2;
+            tb += time_us([&] { r = dijkstra_with<Queue>(g, s); });
+            ta += time_us([&] { r2 = dijkstra_with<Queue>(g, s, adjusted); });
+            if (r2.dist != ref.dist) ++mismatches;
+        }
+        std::cout << name << tb / queries << "        " << ta / queries << "\n";
+    };
+    bench_queue("binary heap   ", BinaryHeapQueue());
+    bench_queue("dial          ", DialQueue());
+    bench_queue("radix heap    ", RadixHeapQueue());
+    bench_queue("4-ary heap    ", DaryHeapQueue<4>());
+
+    // distance tables: bucket many-to-many vs. one early-exit search per row
+    {
+        const int dim = 200;
+        std::vector<NodeId> sources(dim), targets(dim);
+        for (auto& v : sources) v = pick(rng);
+        for (auto& v : targets) v = pick(rng);
+        std::vector<long long> base_table, adj_table, rows(sources.size() * targets.size());
+        double t_base = time_us([&] { base_table = many_to_many(ch.upward(), sources, targets); });
+        double t_adj_table = time_us([&] { adj_table = many_to_many(metric, sources, targets); });
+        double t_rows = time_us([&] {
+            for (size_t i = 0; i < sources.size(); ++i) {
+                auto r = route_to_targets(g, sources[i], targets, adjusted);
+                for (size_t j = 0; j < targets.size(); ++j) rows[i * targets.size() + j] = r[j].dist;
+            }
+        });
+        if (rows != adj_table) ++mismatches;
+        for (int k = 0; k < 20; ++k) {
+            size_t i = pick(rng) % sources.size();
+            DijkstraResult ref = dijkstra(g, sources[i]);
+            for (size_t j = 0; j < targets.size(); ++j)
+                if (ref.dist[targets[j]] != base_table[i * targets.size() + j]) { ++mismatches; break; }
+        }
+        std::cout << "matrix " << dim << "x" << dim << ": ch buckets " << t_base / 1000.0 << " ms, cch buckets "
+            << t_adj_table / 1000.0 << " ms, per-row dijkstra " << t_rows / 1000.0 << " ms\n";
+    }
+
+    std::cout << "mismatches: " << mismatches << "\n";
+    return mismatches == 0 ? 0 : 1;
+}
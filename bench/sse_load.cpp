@@ -0,0 +1,99 @@
+// Synthetic SSE clients for the event-loop endpoint (Linux).
+// Usage: sse_load [port=8081] [clients=1000] [seconds=30]
+// Opens `clients` connections to GET /events, then reports how many stayed connected
+// and how many events / heartbeats arrived. Trigger events meanwhile with e.g.
+//   curl -XPOST localhost:8080/simulate -d '{"node":2,"severity":3}'
+// Raise the fd limit (ulimit -n) for more than ~1000 clients.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Client {
+    bool open = true;
+    std::string tail;         // partial line carried between reads
+    long long events = 0;     // data frames other than heartbeats
+    long long heartbeats = 0;
+};
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? std::atoi(argv[1]) : 8081;
+    int clients = argc > 2 ? std::atoi(argv[2]) : 1000;
+    int seconds = argc > 3 ? std::atoi(argv[3]) : 30;
+
+    int ep = epoll_create1(0);
+    std::unordered_map<int, Client> conns;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const std::string request = "GET /events HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n\r\n";
+
+    int failed = 0;
+    for (int i = 0; i < clients; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+            send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+            if (fd >= 0) close(fd);
+            ++failed;
+            continue;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+        conns[fd];
+    }
+    std::cout << "connected " << conns.size() << " / " << clients << " (" << failed << " failed)\n";
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    std::vector<epoll_event> events(1024);
+    char buf[8192];
+    long long bytes = 0;
+    while (std::chrono::steady_clock::now() < deadline) {
+        int ready = epoll_wait(ep, events.data(), (int)events.size(), 200);
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            Client& c = conns[fd];
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                if (n < 0 && errno == EAGAIN) continue;
+                c.open = false;
+                epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+                close(fd);
+                continue;
+            }
+            bytes += n;
+            c.tail.append(buf, (size_t)n);
+            size_t start = 0, end;
+            while ((end = c.tail.find('\n', start)) != std::string::npos) {
+                std::string line = c.tail.substr(start, end - start);
+                if (line.rfind("data:", 0) == 0) {
+                    if (line.find("\"heartbeat\"") != std::string::npos) ++c.heartbeats;
+                    else if (line.find("\"status\":\"ok\"") == std::string::npos) ++c.events; // skip the greeting
+                }
+                start = end + 1;
+            }
+            c.tail.erase(0, start);
+        }
+    }
+
+    long long open = 0, ev = 0, hb = 0;
+    for (auto& [fd, c] : conns) {
+        if (c.open) { ++open; close(fd); }
+        ev += c.events;
+        hb += c.heartbeats;
+    }
+    std::cout << "still open " << open << ", events " << ev << " (" << (conns.empty() ? 0 : ev / (long long)conns.size())
+        << " per client), heartbeats " << hb << ", bytes " << bytes << "\n";
+    return 0;
+}
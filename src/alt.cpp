@@ -0,0 +1,130 @@
+#include "alt.hpp"
+#include <algorithm>
+#include <queue>
+
+// one-to-all distances over out-edges (forward) or in-edges (backward)
+static std::vector<long long> distances(const Graph& g, NodeId root, bool backward) {
+    std::vector<long long> dist(g.n, INF);
+    using pli = std::pair<long long, int>;
+    std::priority_queue<pli, std::vector<pli>, std::greater<pli>> pq;
+    dist[root] = 0;
+    pq.push({ 0, root });
+    while (!pq.empty()) {
+        auto [d, u] = pq.top(); pq.pop();
+        if (d != dist[u]) continue;
+        auto relax = [&](NodeId v, long long w) {
+            if (d + w < dist[v]) { dist[v] = d + w; pq.push({ dist[v], v }); }
+        };
+        if (backward) for (const auto& ie : g.in(u)) relax(ie.from, g.edges[ie.id].w);
+        else for (const auto& e : g.adj(u)) relax(e.to, e.w);
+    }
+    return dist;
+}
+
+Landmarks Landmarks::build(const Graph& g, int count) {
+    Landmarks lm;
+    lm.n_ = g.n;
+    if (g.n == 0) return lm;
+    count = std::min(count, g.n);
+
+    // farthest-point selection: start from the node farthest from node 0, then keep
+    // adding the node whose nearest landmark is farthest away (unreached nodes first)
+    std::vector<long long> nearest(g.n, INF);
+    auto d0 = distances(g, 0, false);
+    NodeId next = 0;
+    for (int v = 0; v < g.n; ++v)
+        if (d0[v] != INF && d0[v] > d0[next]) next = v;
+
+    for (int k = 0; k < count; ++k) {
+        lm.nodes_.push_back(next);
+        auto fwd = distances(g, next, false);
+        auto bwd = distances(g, next, true);
+        lm.from_.insert(lm.from_.end(), fwd.begin(), fwd.end());
+        lm.to_.insert(lm.to_.end(), bwd.begin(), bwd.end());
+
+        nearest[next] = 0;
+        for (int v = 0; v < g.n; ++v) nearest[v] = std::min(nearest[v], fwd[v]);
+        NodeId pick = -1;
+        for (int v = 0; v < g.n; ++v) {
+            if (nearest[v] == 0) continue;
+            if (pick < 0 || nearest[v] > nearest[pick]) pick = v;
+        }
+        if (pick < 0) break;
+        next = pick;
+    }
+    return lm;
+}
+
+long long Landmarks::lower_bound(NodeId v, NodeId t) const {
+    long long best = 0;
+    for (size_t k = 0; k < nodes_.size(); ++k) {
+        const long long* from = from_.data() + k * n_;
+        const long long* to = to_.data() + k * n_;
+        // d(L,t) <= d(L,v) + d(v,t)   and   d(v,L) <= d(v,t) + d(t,L)
+        if (from[t] != INF && from[v] != INF) best = std::max(best, from[t] - from[v]);
+        if (to[v] != INF && to[t] != INF) best = std::max(best, to[v] - to[t]);
+    }
+    return best;
+}
+
+template <typename WeightOf>
+static RouteResult run_astar(const Graph& g, int src, int dst, const Landmarks& lm, WeightOf weight_of,
+                             int* settled, DijkstraWorkspace& ws) {
+    int n = g.n;
+    RouteResult out;
+    if (settled) *settled = 0;
+    if (src < 0 || src >= n || dst < 0 || dst >= n) return out;
+    SearchLabels& lab = ws.fwd;
+    ReusableHeap& pq = ws.qf;
+    lab.reset(n);
+    pq.clear();
+
+    // potentials are evaluated once per touched node and cached in aux.dist
+    bool usable = lm.node_count() == n;
+    SearchLabels& h = ws.aux;
+    h.reset(n);
+    auto bound = [&](NodeId v) {
+        long long b = h.dist(v);
+        if (b == INF) { b = usable ? lm.lower_bound(v, dst) : 0; h.set(v, b, -1); }
+        return b;
+    };
+
+    lab.set(src, 0, -1);
+    pq.push(bound(src), src);
+    bool reached = false;
+    while (!pq.empty()) {
+        auto [key, u] = pq.top(); pq.pop();
+        long long du = lab.dist(u);
+        if (key != du + h.dist(u)) continue;
+        if (settled) ++*settled;
+        if (u == dst) { reached = true; break; }
+        for (int i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            NodeId v = g.edges[i].to;
+            long long nd = du + weight_of(i);
+            if (nd < lab.dist(v)) {
+                lab.set(v, nd, u);
+                pq.push(nd + bound(v), v);
+            }
+        }
+    }
+    if (!reached) return out;
+
+    for (int v = dst; v != -1; v = lab.prev(v)) {
+        out.path.push_back(v);
+        out.arrival.push_back(lab.dist(v));
+    }
+    std::reverse(out.path.begin(), out.path.end());
+    std::reverse(out.arrival.begin(), out.arrival.end());
+    out.dist = lab.dist(dst);
+    return out;
+}
+
+RouteResult astar_route(const Graph& g, int src, int dst, const Landmarks& lm, int* settled, DijkstraWorkspace& ws) {
+    return run_astar(g, src, dst, lm, [&g](int i) { return g.edges[i].w; }, settled, ws);
+}
+
+RouteResult astar_route(const Graph& g, int src, int dst, const Landmarks& lm, const EdgeWeights& w,
+                        int* settled, DijkstraWorkspace& ws) {
+    if ((int)w.size() != g.edge_count()) return astar_route(g, src, dst, lm, settled, ws);
+    return run_astar(g, src, dst, lm, [&w](int i) { return w[i]; }, settled, ws);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include "dijkstra.hpp"
+
+// Landmark distance tables for ALT (A*, landmarks, triangle inequality).
+// Built once from the baseline graph. Incident penalties only ever raise edge
+// costs, so the bounds stay admissible for any overlay derived from it.
+class Landmarks {
+public:
+    // Picks `count` landmarks by farthest-point selection and runs a forward and a
+    // backward search from each of them.
+    static Landmarks build(const Graph& g, int count = 16);
+
+    // Lower bound on the cost from v to t.
+    long long lower_bound(NodeId v, NodeId t) const;
+
+    int count() const { return (int)nodes_.size(); }
+    int node_count() const { return n_; }
+    const std::vector<NodeId>& nodes() const { return nodes_; }
+
+private:
+    int n_ = 0;
+    std::vector<NodeId> nodes_;
+    std::vector<long long> from_;  // from_[k * n + v] = d(L_k, v)
+    std::vector<long long> to_;    // to_[k * n + v]   = d(v, L_k)
+};
+
+// Goal-directed point-to-point search; stops when dst is settled.
+RouteResult astar_route(const Graph& g, int src, int dst, const Landmarks& lm, int* settled = nullptr,
+                        DijkstraWorkspace& ws = DijkstraWorkspace::local());
+RouteResult astar_route(const Graph& g, int src, int dst, const Landmarks& lm, const EdgeWeights& w,
+                        int* settled = nullptr, DijkstraWorkspace& ws = DijkstraWorkspace::local());
@@ -0,0 +1,172 @@
+#include "broadcaster.hpp"
+#include <algorithm>
+#include <limits>
+
+Broadcaster::Broadcaster(size_t replay_capacity) : capacity_(replay_capacity ? replay_capacity : 1) {
+    version_ = (unsigned long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+Broadcaster::Indexed::Indexed(Keyframe keyframe) : k(std::move(keyframe)) {
+    for (size_t i = 0; i < k.items.size(); ++i) {
+        const EventTags& t = k.items[i].tags;
+        if (t.topic == EventTags::Incidents && t.node >= 0) {
+            by_node.push_back({ t.node, i });
+            by_severity.push_back({ -t.severity, i });
+        }
+        else untargeted.push_back(i);
+    }
+    std::sort(by_node.begin(), by_node.end());
+    std::sort(by_severity.begin(), by_severity.end());
+}
+
+void Broadcaster::push(const Draft& event) {
+    Event e;
+    e.id = ++version_;
+    e.frame = std::make_shared<const std::string>("id: " + std::to_string(e.id) + "\n" + event.text);
+    e.tags = event.tags;
+    ring_.push_back(std::move(e));
+    if (ring_.size() > capacity_) ring_.pop_front();
+}
+
+void Broadcaster::notify() {
+    cv_.notify_all();
+    for (auto& fn : listeners_) fn();
+}
+
+void Broadcaster::publish(const std::vector<Draft>& events, Keyframe keyframe) {
+    auto indexed = std::make_shared<const Indexed>(std::move(keyframe)); // outside the lock
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        for (const auto& event : events) push(event);
+        keyframe_ = std::move(indexed);
+        keyframe_id_ = version_;
+        rendered_.clear();
+        rendered_index_.clear();
+    }
+    notify();
+}
+
+void Broadcaster::reset(Keyframe keyframe) {
+    auto indexed = std::make_shared<const Indexed>(std::move(keyframe));
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        ring_.clear();
+        keyframe_ = std::move(indexed);
+        keyframe_id_ = ++version_;
+        rendered_.clear();
+        rendered_index_.clear();
+    }
+    notify();
+}
+
+Broadcaster::Frame Broadcaster::render_keyframe(const Subscription& sub) {
+    if (!keyframe_) return nullptr;
+    std::string key = sub.key();
+    auto it = rendered_index_.find(key);
+    if (it != rendered_index_.end()) {
+        rendered_.splice(rendered_.begin(), rendered_, it->second);
+        return it->second->second;
+    }
+
+    const Indexed& x = *keyframe_;
+    const Keyframe& k = x.k;
+    std::string body;
+    if (sub.matches(k.tags)) {
+        body = k.head;
+        bool first = true;
+        auto emit = [&](size_t i) {
+            if (!sub.matches(k.items[i].tags)) return;
+            if (!first) body += ',';
+            body += k.items[i].text;
+            first = false;
+        };
+        if (sub.nodes.empty() && sub.min_severity <= 0) {
+            for (size_t i = 0; i < k.items.size(); ++i) emit(i);
+        }
+        else {
+            // candidates from the index, back in publication order
+            std::vector<size_t> picked(x.untargeted);
+            if (!sub.nodes.empty()) {
+                for (const auto& r : sub.nodes) {
+                    auto it = std::lower_bound(x.by_node.begin(), x.by_node.end(), std::make_pair(r.first, size_t(0)));
+                    for (; it != x.by_node.end() && it->first <= r.second; ++it) picked.push_back(it->second);
+                }
+            }
+            else {
+                auto end = std::upper_bound(x.by_severity.begin(), x.by_severity.end(),
+                                            std::make_pair(-sub.min_severity, std::numeric_limits<size_t>::max()));
+                for (auto it = x.by_severity.begin(); it != end; ++it) picked.push_back(it->second);
+            }
+            std::sort(picked.begin(), picked.end());
+            for (size_t i : picked) emit(i);
+        }
+        body += k.tail;
+    }
+    for (const auto& event : k.events)
+        if (sub.matches(event.tags)) body += event.text;
+    Frame f;
+    if (!body.empty()) f = std::make_shared<const std::string>("id: " + std::to_string(keyframe_id_) + "\n" + body);
+    rendered_.emplace_front(key, f);
+    rendered_index_[std::move(key)] = rendered_.begin();
+    if (rendered_.size() > kMaxRendered) {
+        rendered_index_.erase(rendered_.back().first);
+        rendered_.pop_back();
+    }
+    return f;
+}
+
+std::vector<Broadcaster::Event> Broadcaster::collect(unsigned long long& seen, const Subscription& sub) {
+    std::vector<Event> out;
+    if (seen > version_) seen = 0; // not one of ours: treat like a fresh connection
+    if ((ring_.empty() && !keyframe_) || seen == version_) return out;
+    unsigned long long oldest = version_ - ring_.size() + 1;
+    if (seen + 1 < oldest) {
+        // too far behind to replay: restart from the keyframe
+        if (keyframe_) {
+            Event e;
+            e.id = keyframe_id_;
+            e.frame = render_keyframe(sub);
+            e.keyframe = true;
+            if (e.frame) out.push_back(std::move(e));
+            seen = keyframe_id_;
+        }
+        else {
+            seen = version_ - 1;
+        }
+    }
+    if (seen < version_) {
+        if (seen + 1 < oldest) seen = oldest - 1; // keyframe older than the ring
+        for (auto it = ring_.end() - (version_ - seen); it != ring_.end(); ++it)
+            if (sub.matches(it->tags)) out.push_back(*it);
+    }
+    seen = version_;
+    return out;
+}
+
+std::vector<Broadcaster::Event> Broadcaster::since(unsigned long long& seen, const Subscription& sub) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return collect(seen, sub);
+}
+
+std::vector<Broadcaster::Event> Broadcaster::wait_next(unsigned long long& seen, std::chrono::milliseconds timeout,
+                                                       const Subscription& sub) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    cv_.wait_for(lk, timeout, [&] { return version_ > seen; });
+    return collect(seen, sub);
+}
+
+Broadcaster::Frame Broadcaster::keyframe(const Subscription& sub, unsigned long long* id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (id) *id = keyframe_id_;
+    return render_keyframe(sub);
+}
+
+void Broadcaster::add_listener(std::function<void()> fn) {
+    listeners_.push_back(std::move(fn));
+}
+
+unsigned long long Broadcaster::version() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return version_;
+}
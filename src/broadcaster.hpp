@@ -0,0 +1,118 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "subscription.hpp"
+
+// Hands server-sent events to every connection. The producer serializes each event
+// once into an immutable buffer; connections share those buffers and do nothing but
+// wait for newer ones and write them.
+//
+// Every event gets a monotonically increasing id (seeded from the wall clock, so ids of
+// a restarted server are larger than the previous run's) and the last few are kept in a
+// ring, so a client reconnecting with Last-Event-ID receives only what it missed.
+// Clients that are new (or too far behind) start from the keyframe, a full-state frame
+// the producer keeps current, followed by whatever was published after it.
+//
+// Frames carry EventTags; readers pass their Subscription and only get matching frames.
+// The keyframe is rendered once per distinct subscription and cached until it changes
+// (the most recently used 64 renders); its items are indexed by node and severity, so
+// rendering a narrow subscription costs what it matches, not the whole state.
+class Broadcaster {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    // A published frame ("id:" line included) and what it is about.
+    struct Event {
+        unsigned long long id = 0;
+        Frame frame;
+        EventTags tags;
+        bool keyframe = false;   // the keyframe as rendered for the reader's subscription
+    };
+
+    // An event before publication: "event: ...\n" / "data: ...\n" lines ending in a blank line.
+    struct Draft {
+        std::string text;
+        EventTags tags;
+    };
+
+    // Full state for clients starting from scratch. The first event's data ends in a JSON
+    // array: head + matching items joined by ',' + tail (the event itself is dropped for
+    // subscriptions that do not match `tags`). Then the matching whole `events`.
+    struct Keyframe {
+        std::string head;
+        std::vector<Draft> items;
+        std::string tail;
+        EventTags tags;
+        std::vector<Draft> events;
+    };
+
+    explicit Broadcaster(size_t replay_capacity = 256);
+
+    // Publishes `events` as consecutive frames, each prefixed with its "id:" line, and in
+    // the same step replaces the keyframe with `keyframe` (the full state after the last
+    // of them). Wakes all waiters.
+    void publish(const std::vector<Draft>& events, Keyframe keyframe);
+
+    // Replaces the keyframe and forgets the replay ring, so every reader restarts from it.
+    // For producers that lost track of what changed.
+    void reset(Keyframe keyframe);
+
+    // Frames after `seen` that match `sub`, oldest first; `seen` advances to the newest id.
+    // If `seen` is older than the ring (or unknown, e.g. 0) the keyframe and the frames after
+    // it are returned, or just the latest frame if no keyframe was ever set.
+    std::vector<Event> since(unsigned long long& seen, const Subscription& sub = Subscription());
+
+    // since(), waiting up to `timeout` for something newer than `seen`; empty on timeout
+    // or when nothing new matches.
+    std::vector<Event> wait_next(unsigned long long& seen, std::chrono::milliseconds timeout,
+                                 const Subscription& sub = Subscription());
+
+    // The current keyframe as seen by `sub`; null if none was set or nothing in it matches.
+    // `id` (optional) receives the id of the newest frame it accounts for.
+    Frame keyframe(const Subscription& sub, unsigned long long* id = nullptr);
+
+    unsigned long long version();
+
+    // Called after every publish, outside the lock; for event loops that cannot block
+    // in wait_next(). Register before the first publish.
+    void add_listener(std::function<void()> fn);
+
+private:
+    // A keyframe with its items indexed for the node and severity filters.
+    struct Indexed {
+        Keyframe k;
+        std::vector<std::pair<int, size_t>> by_node;     // (node, item), sorted
+        std::vector<std::pair<int, size_t>> by_severity; // (-severity, item), sorted
+        std::vector<size_t> untargeted;                  // items not about one incident
+        explicit Indexed(Keyframe keyframe);
+    };
+
+    // mutex_ held
+    std::vector<Event> collect(unsigned long long& seen, const Subscription& sub);
+    Frame render_keyframe(const Subscription& sub);
+    void push(const Draft& event);
+    void notify();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    size_t capacity_;
+    std::deque<Event> ring_;             // ids version_ - ring_.size() + 1 .. version_
+    unsigned long long version_ = 0;     // id of the newest frame
+    std::shared_ptr<const Indexed> keyframe_;
+    unsigned long long keyframe_id_ = 0; // newest frame the keyframe accounts for
+    // keyframe per Subscription::key(), most recently used first; capped, since clients
+    // pick the keys
+    static const size_t kMaxRendered = 64;
+    std::list<std::pair<std::string, Frame>> rendered_;
+    std::unordered_map<std::string, std::list<std::pair<std::string, Frame>>::iterator> rendered_index_;
+    std::vector<std::function<void()>> listeners_;
+};
@@ -0,0 +1,196 @@
+#include "cch.hpp"
+#include <algorithm>
+
+namespace {
+
+const int kLeafSize = 8;
+
+// Node order by recursive BFS-level bisection: every component is split by the
+// middle level of a BFS from a pseudo-peripheral node, and that separator is
+// ranked above both halves. Needs no coordinates and no weights.
+std::vector<int> nested_dissection_ranks(const std::vector<std::vector<NodeId>>& nbrs) {
+    int n = (int)nbrs.size();
+    std::vector<int> rank(n, -1);
+    std::vector<int> mark(n, 0), level(n, -1);
+    int stamp = 0;
+    int next_high = n - 1;
+
+    // BFS restricted to nodes carrying `set_stamp`; fills `order`, returns last node reached
+    auto bfs = [&](NodeId start, int set_stamp, std::vector<NodeId>& order) {
+        order.clear();
+        order.push_back(start);
+        level[start] = 0;
+        int visit = ++stamp;
+        mark[start] = visit;
+        for (size_t i = 0; i < order.size(); ++i) {
+            NodeId u = order[i];
+            for (NodeId v : nbrs[u]) {
+                if (mark[v] != set_stamp || rank[v] >= 0) continue;
+                mark[v] = visit;
+                level[v] = level[u] + 1;
+                order.push_back(v);
+            }
+        }
+        // restore membership so the set can be walked again
+        for (NodeId v : order) mark[v] = set_stamp;
+        return order.back();
+    };
+
+    std::vector<std::vector<NodeId>> tasks;
+    tasks.emplace_back();
+    for (int v = 0; v < n; ++v) tasks.back().push_back(v);
+    std::vector<NodeId> order;
+
+    while (!tasks.empty()) {
+        std::vector<NodeId> set = std::move(tasks.back());
+        tasks.pop_back();
+        if (set.empty()) continue;
+        int set_stamp = ++stamp;
+        for (NodeId v : set) mark[v] = set_stamp;
+
+        // split into connected components first
+        bfs(set.front(), set_stamp, order);
+        if (order.size() < set.size()) {
+            int seen = ++stamp;
+            for (NodeId v : set) {
+                if (mark[v] == seen) continue;
+                bfs(v, set_stamp, order);
+                for (NodeId u : order) mark[u] = seen;
+                tasks.push_back(order);
+            }
+            continue;
+        }
+
+        if ((int)set.size() <= kLeafSize) {
+            for (NodeId v : set) rank[v] = next_high--;
+            continue;
+        }
+
+        // pseudo-peripheral start: BFS twice, restart from the farthest node
+        NodeId far = bfs(set.front(), set_stamp, order);
+        far = bfs(far, set_stamp, order);
+        bfs(far, set_stamp, order);
+
+        // thinnest BFS level whose removal leaves neither side with more than 2/3 of the set
+        int size = (int)order.size();
+        int sep_level = level[order[size / 2]];
+        size_t best_width = (size_t)-1;
+        for (int i = size / 3, end = (2 * size) / 3; i <= end; ) {
+            int lv = level[order[i]];
+            int j = i;
+            while (j < size && level[order[j]] == lv) ++j;
+            int first = i;
+            while (first > 0 && level[order[first - 1]] == lv) --first;
+            if ((size_t)(j - first) < best_width) { best_width = (size_t)(j - first); sep_level = lv; }
+            i = j;
+        }
+        std::vector<NodeId> below, above;
+        for (NodeId v : order) {
+            if (level[v] < sep_level) below.push_back(v);
+            else if (level[v] > sep_level) above.push_back(v);
+            else rank[v] = next_high--;
+        }
+        tasks.push_back(std::move(below));
+        tasks.push_back(std::move(above));
+    }
+    return rank;
+}
+
+} // namespace
+
+CustomizableCH CustomizableCH::build(const Graph& g) {
+    int n = g.n;
+    CustomizableCH c;
+
+    // undirected, de-duplicated neighbourhoods
+    std::vector<std::vector<NodeId>> nbrs(n);
+    for (int u = 0; u < n; ++u) {
+        for (const auto& e : g.adj(u)) {
+            if (e.to == u) continue;
+            nbrs[u].push_back(e.to);
+            nbrs[e.to].push_back(u);
+        }
+    }
+    for (auto& l : nbrs) { std::sort(l.begin(), l.end()); l.erase(std::unique(l.begin(), l.end()), l.end()); }
+
+    std::vector<int> rank = nested_dissection_ranks(nbrs);
+    std::vector<NodeId> by_rank(n);
+    for (int v = 0; v < n; ++v) by_rank[rank[v]] = v;
+
+    // chordal completion: eliminating v turns its upper neighbours into a clique,
+    // which is enough to forward to the lowest of them
+    std::vector<std::vector<NodeId>> upper(n);
+    for (int v = 0; v < n; ++v)
+        for (NodeId u : nbrs[v]) if (rank[u] > rank[v]) upper[v].push_back(u);
+    nbrs.clear();
+    for (int r = 0; r < n; ++r) {
+        NodeId v = by_rank[r];
+        auto& up = upper[v];
+        std::sort(up.begin(), up.end(), [&rank](NodeId a, NodeId b) { return rank[a] < rank[b]; });
+        up.erase(std::unique(up.begin(), up.end()), up.end());
+        if (up.size() < 2) continue;
+        auto& parent = upper[up.front()];
+        parent.insert(parent.end(), up.begin() + 1, up.end());
+    }
+
+    UpwardGraph& h = c.topo_;
+    h.n = n;
+    h.rank = rank;
+    h.offsets.assign(n + 1, 0);
+    for (int v = 0; v < n; ++v) h.offsets[v + 1] = h.offsets[v] + (int)upper[v].size();
+    h.arcs.reserve(h.offsets[n]);
+    for (int v = 0; v < n; ++v) {
+        std::vector<NodeId> by_id = upper[v];
+        std::sort(by_id.begin(), by_id.end());
+        for (NodeId u : by_id) h.arcs.push_back({ u, INF, INF, -1, -1 });
+    }
+
+    // where each original edge lands
+    c.edge_arc_.assign(g.edges.size(), -1);
+    c.edge_forward_.assign(g.edges.size(), 0);
+    for (int u = 0; u < n; ++u) {
+        for (int i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            NodeId v = g.edges[i].to;
+            if (v == u) continue;
+            const UpArc* arc = h.find_arc(u, v);
+            c.edge_arc_[i] = (int)(arc - h.arcs.data());
+            c.edge_forward_[i] = rank[u] < rank[v];
+        }
+    }
+
+    // lower triangles, enumerated bottom-up so customize() can run them in sequence
+    for (int r = 0; r < n; ++r) {
+        NodeId x = by_rank[r];
+        const auto& up = upper[x]; // sorted by rank
+        for (size_t i = 0; i < up.size(); ++i) {
+            int xu = (int)(h.find_arc(x, up[i]) - h.arcs.data());
+            for (size_t j = i + 1; j < up.size(); ++j) {
+                int xv = (int)(h.find_arc(x, up[j]) - h.arcs.data());
+                int uv = (int)(h.find_arc(up[i], up[j]) - h.arcs.data());
+                c.triangles_.push_back({ x, xu, xv, uv });
+            }
+        }
+    }
+    return c;
+}
+
+UpwardGraph CustomizableCH::customize(const EdgeWeights& w) const {
+    UpwardGraph h = topo_;
+    for (size_t i = 0; i < edge_arc_.size() && i < w.size(); ++i) {
+        if (edge_arc_[i] < 0) continue;
+        UpArc& arc = h.arcs[edge_arc_[i]];
+        long long& slot = edge_forward_[i] ? arc.fw : arc.bw;
+        slot = std::min(slot, w[i]);
+    }
+
+    // basic customization: x is the lowest node of every triangle it heads, so its
+    // arcs are final by the time its triangles are processed
+    for (const auto& t : triangles_) {
+        const UpArc& xu = h.arcs[t.xu];
+        const UpArc& xv = h.arcs[t.xv];
+        UpArc& uv = h.arcs[t.uv];
+        if (xu.bw != INF && xv.fw != INF && xu.bw + xv.fw < uv.fw) { uv.fw = xu.bw + xv.fw; uv.fw_mid = t.x; }
+        if (xv.bw != INF && xu.fw != INF && xv.bw + xu.fw < uv.bw) { uv.bw = xv.bw + xu.fw; uv.bw_mid = t.x; }
+    }
+    return h;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include "ch.hpp"
+
+// Customizable Contraction Hierarchy. The node order (nested dissection) and
+// shortcut topology depend only on the graph's shape; weights are applied later
+// by customize(), which is cheap enough to re-run on every incident change.
+class CustomizableCH {
+public:
+    // Metric-independent preprocessing: nested dissection order, chordal
+    // shortcut topology and the lower-triangle list used by customize().
+    static CustomizableCH build(const Graph& g);
+
+    // Applies per-edge weights (indexed like Graph::edges of the graph passed to
+    // build()) and returns a ready-to-query upward graph.
+    UpwardGraph customize(const EdgeWeights& w) const;
+
+    int node_count() const { return topo_.n; }
+    int edge_count() const { return (int)edge_arc_.size(); }
+    int arc_count() const { return (int)topo_.arcs.size(); }
+
+private:
+    // Arcs (x,u), (x,v) and (u,v) of one lower triangle, with rank x < u < v.
+    struct Triangle { NodeId x; int xu; int xv; int uv; };
+
+    UpwardGraph topo_;                 // arcs with all weights INF
+    std::vector<int> edge_arc_;        // original edge id -> arc index
+    std::vector<char> edge_forward_;   // whether the edge runs lower -> higher rank
+    std::vector<Triangle> triangles_;  // grouped by x in ascending rank
+};
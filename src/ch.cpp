@@ -0,0 +1,381 @@
+#include "ch.hpp"
+#include <algorithm>
+#include <fstream>
+#include <queue>
+
+// ---------------- upward graph query ----------------
+
+const UpArc* UpwardGraph::find_arc(NodeId a, NodeId b) const {
+    if (rank[a] > rank[b]) std::swap(a, b);
+    auto first = arcs.begin() + offsets[a];
+    auto last = arcs.begin() + offsets[a + 1];
+    auto it = std::lower_bound(first, last, b, [](const UpArc& arc, NodeId v) { return arc.to < v; });
+    return (it != last && it->to == b) ? &*it : nullptr;
+}
+
+// Expands hierarchy hop u->v into original edges, appending (node, edge cost) pairs.
+static void unpack_hop(const UpwardGraph& h, NodeId u, NodeId v, std::vector<std::pair<NodeId, long long>>& out) {
+    std::vector<std::pair<NodeId, NodeId>> stack{ { u, v } };
+    while (!stack.empty()) {
+        auto [a, b] = stack.back(); stack.pop_back();
+        const UpArc* arc = h.find_arc(a, b);
+        if (!arc) continue;
+        bool up = h.rank[a] < h.rank[b];
+        NodeId mid = up ? arc->fw_mid : arc->bw_mid;
+        if (mid < 0) {
+            out.push_back({ b, up ? arc->fw : arc->bw });
+        }
+        else {
+            stack.push_back({ mid, b });
+            stack.push_back({ a, mid });
+        }
+    }
+}
+
+RouteResult upward_route(const UpwardGraph& h, int src, int dst, int* settled, DijkstraWorkspace& ws) {
+    RouteResult out;
+    int n = h.n;
+    if (settled) *settled = 0;
+    if (src < 0 || src >= n || dst < 0 || dst >= n) return out;
+
+    SearchLabels& f = ws.fwd;
+    SearchLabels& b = ws.bwd;
+    f.reset(n); b.reset(n);
+    ws.qf.clear(); ws.qb.clear();
+    f.set(src, 0, -1); ws.qf.push(0, src);
+    b.set(dst, 0, -1); ws.qb.push(0, dst);
+    long long best = INF;
+    int meet = -1;
+
+    // each side only climbs; a side is finished once its smallest key reaches `best`
+    auto step = [&](ReusableHeap& q, SearchLabels& self, const SearchLabels& other, bool forward) {
+        auto [d, u] = q.top(); q.pop();
+        if (d != self.dist(u)) return;
+        if (settled) ++*settled;
+        long long du = other.dist(u);
+        if (du != INF && d + du < best) { best = d + du; meet = u; }
+        for (int i = h.offsets[u]; i < h.offsets[u + 1]; ++i) {
+            const UpArc& arc = h.arcs[i];
+            long long w = forward ? arc.fw : arc.bw;
+            if (w == INF) continue;
+            long long nd = d + w;
+            if (nd < self.dist(arc.to)) { self.set(arc.to, nd, u); q.push(nd, arc.to); }
+        }
+    };
+    while (true) {
+        bool f_open = !ws.qf.empty() && ws.qf.top().first < best;
+        bool b_open = !ws.qb.empty() && ws.qb.top().first < best;
+        if (!f_open && !b_open) break;
+        if (f_open && (!b_open || ws.qf.top().first <= ws.qb.top().first)) step(ws.qf, f, b, true);
+        else step(ws.qb, b, f, false);
+    }
+    if (meet < 0) return out;
+
+    // hierarchy-level path: src .. meet (forward tree), then meet .. dst (backward tree)
+    std::vector<NodeId> coarse;
+    for (int v = meet; v != -1; v = f.prev(v)) coarse.push_back(v);
+    std::reverse(coarse.begin(), coarse.end());
+    for (int v = b.prev(meet); v != -1; v = b.prev(v)) coarse.push_back(v);
+
+    std::vector<std::pair<NodeId, long long>> hops;
+    for (size_t i = 0; i + 1 < coarse.size(); ++i) unpack_hop(h, coarse[i], coarse[i + 1], hops);
+
+    // aux.dist(v) = index of v in the path; a zero-cost cycle can revisit a node,
+    // in which case the loop is cut back to the node's first occurrence
+    SearchLabels& pos = ws.aux;
+    pos.reset(n);
+    out.path.push_back(src);
+    out.arrival.push_back(0);
+    pos.set(src, 0, -1);
+    for (const auto& hop : hops) {
+        NodeId v = hop.first;
+        if (pos.dist(v) != INF) {
+            while (out.path.back() != v) {
+                pos.set(out.path.back(), INF, -1);
+                out.path.pop_back();
+                out.arrival.pop_back();
+            }
+            continue;
+        }
+        pos.set(v, (long long)out.path.size(), -1);
+        out.arrival.push_back(out.arrival.back() + hop.second);
+        out.path.push_back(v);
+    }
+    out.dist = out.arrival.back();
+    return out;
+}
+
+// ---------------- contraction ----------------
+
+namespace {
+
+struct DynArc { NodeId to; long long w; NodeId mid; };
+
+// keeps the cheaper of parallel arcs; returns true if `list` changed
+bool add_or_improve(std::vector<DynArc>& list, NodeId to, long long w, NodeId mid) {
+    for (auto& a : list) {
+        if (a.to != to) continue;
+        if (w >= a.w) return false;
+        a.w = w; a.mid = mid;
+        return true;
+    }
+    list.push_back({ to, w, mid });
+    return true;
+}
+
+class Contractor {
+public:
+    explicit Contractor(const Graph& g)
+        : n_(g.n), out_(g.n), in_(g.n), contracted_(g.n, 0), deleted_nbrs_(g.n, 0),
+          dist_(g.n, INF), stamp_(g.n, 0) {
+        for (int u = 0; u < n_; ++u) {
+            for (const auto& e : g.adj(u)) {
+                if (e.to == u) continue;
+                if (add_or_improve(out_[u], e.to, e.w, -1)) add_or_improve(in_[e.to], u, e.w, -1);
+            }
+        }
+    }
+
+    UpwardGraph run(int& shortcuts) {
+        UpwardGraph h;
+        h.n = n_;
+        h.rank.assign(n_, 0);
+        std::vector<std::vector<UpArc>> up(n_);
+
+        using pii = std::pair<int, int>;
+        std::priority_queue<pii, std::vector<pii>, std::greater<pii>> order;
+        for (int v = 0; v < n_; ++v) order.push({ priority(v), v });
+
+        int next_rank = 0;
+        shortcuts = 0;
+        while (!order.empty()) {
+            auto [p, v] = order.top(); order.pop();
+            if (contracted_[v]) continue;
+            // lazy update: re-evaluate, and defer if the node got worse than the next candidate
+            int fresh = priority(v);
+            if (fresh > p && !order.empty() && fresh > order.top().first) {
+                order.push({ fresh, v });
+                continue;
+            }
+            shortcuts += contract(v, true);
+            h.rank[v] = next_rank++;
+
+            // remaining neighbours all rank above v
+            for (const auto& a : out_[v]) merge_up(up[v], a.to, a.w, a.mid, true);
+            for (const auto& a : in_[v]) merge_up(up[v], a.to, a.w, a.mid, false);
+            detach(v);
+        }
+
+        h.offsets.assign(n_ + 1, 0);
+        for (int v = 0; v < n_; ++v) {
+            std::sort(up[v].begin(), up[v].end(), [](const UpArc& a, const UpArc& b) { return a.to < b.to; });
+            h.offsets[v + 1] = h.offsets[v] + (int)up[v].size();
+        }
+        h.arcs.reserve(h.offsets[n_]);
+        for (int v = 0; v < n_; ++v) h.arcs.insert(h.arcs.end(), up[v].begin(), up[v].end());
+        return h;
+    }
+
+private:
+    // witness searches are cut off early while only estimating priorities
+    static constexpr int kSettleLimit = 500;
+    static constexpr int kEstimateSettleLimit = 40;
+
+    int n_;
+    std::vector<std::vector<DynArc>> out_, in_;
+    std::vector<char> contracted_;
+    std::vector<int> deleted_nbrs_;
+    // witness search state, reset lazily by stamp
+    std::vector<long long> dist_;
+    std::vector<unsigned> stamp_;
+    unsigned round_ = 0;
+
+    static void merge_up(std::vector<UpArc>& list, NodeId to, long long w, NodeId mid, bool forward) {
+        for (auto& a : list) {
+            if (a.to != to) continue;
+            if (forward) { a.fw = w; a.fw_mid = mid; }
+            else { a.bw = w; a.bw_mid = mid; }
+            return;
+        }
+        if (forward) list.push_back({ to, w, INF, mid, -1 });
+        else list.push_back({ to, INF, w, -1, mid });
+    }
+
+    long long dist_of(NodeId v) const { return stamp_[v] == round_ ? dist_[v] : INF; }
+
+    // bounded Dijkstra from `from` in the remaining graph, never passing through `skip`
+    void witness_search(NodeId from, NodeId skip, long long limit, int settle_limit) {
+        ++round_;
+        using pli = std::pair<long long, int>;
+        std::priority_queue<pli, std::vector<pli>, std::greater<pli>> pq;
+        dist_[from] = 0; stamp_[from] = round_;
+        pq.push({ 0, from });
+        int settled = 0;
+        while (!pq.empty() && settled < settle_limit) {
+            auto [d, u] = pq.top(); pq.pop();
+            if (d != dist_of(u)) continue;
+            if (d > limit) break;
+            ++settled;
+            for (const auto& a : out_[u]) {
+                if (a.to == skip) continue;
+                long long nd = d + a.w;
+                if (nd < dist_of(a.to)) { dist_[a.to] = nd; stamp_[a.to] = round_; pq.push({ nd, a.to }); }
+            }
+        }
+    }
+
+    // number of shortcuts contracting v needs; inserts them when `apply` is set
+    int contract(NodeId v, bool apply) {
+        int added = 0;
+        long long max_out = 0;
+        for (const auto& a : out_[v]) max_out = std::max(max_out, a.w);
+        for (const auto& in : in_[v]) {
+            NodeId u = in.to;
+            witness_search(u, v, in.w + max_out, apply ? kSettleLimit : kEstimateSettleLimit);
+            for (const auto& a : out_[v]) {
+                NodeId x = a.to;
+                if (x == u) continue;
+                long long via = in.w + a.w;
+                if (dist_of(x) <= via) continue;
+                ++added;
+                if (apply && add_or_improve(out_[u], x, via, v)) add_or_improve(in_[x], u, via, v);
+            }
+        }
+        return added;
+    }
+
+    int priority(NodeId v) {
+        int degree = (int)(in_[v].size() + out_[v].size());
+        return contract(v, false) - degree + deleted_nbrs_[v];
+    }
+
+    void detach(NodeId v) {
+        contracted_[v] = 1;
+        for (const auto& a : out_[v]) {
+            auto& l = in_[a.to];
+            l.erase(std::remove_if(l.begin(), l.end(), [v](const DynArc& x) { return x.to == v; }), l.end());
+            deleted_nbrs_[a.to]++;
+        }
+        for (const auto& a : in_[v]) {
+            auto& l = out_[a.to];
+            l.erase(std::remove_if(l.begin(), l.end(), [v](const DynArc& x) { return x.to == v; }), l.end());
+            deleted_nbrs_[a.to]++;
+        }
+        out_[v].clear(); out_[v].shrink_to_fit();
+        in_[v].clear(); in_[v].shrink_to_fit();
+    }
+};
+
+template <typename T>
+void write_pod(std::ofstream& os, const T& v) { os.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+template <typename T>
+bool read_pod(std::ifstream& is, T& v) { return (bool)is.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+
+const unsigned kChMagic = 0x48434754;   // "TGCH"
+const unsigned kChFormat = 1;
+
+// Everything the query and unpacking code index with, checked before a loaded
+// hierarchy is used: a corrupt file must not turn into out-of-bounds reads or an
+// unpacking loop that never ends.
+bool well_formed(const UpwardGraph& h) {
+    int n = h.n;
+    std::vector<char> seen(n, 0);
+    for (int r : h.rank) {
+        if (r < 0 || r >= n || seen[r]) return false;
+        seen[r] = 1;
+    }
+    if (h.offsets[0] != 0 || h.offsets[n] != (int)h.arcs.size()) return false;
+    for (int v = 0; v < n; ++v) {
+        if (h.offsets[v] > h.offsets[v + 1]) return false;
+        for (int i = h.offsets[v]; i < h.offsets[v + 1]; ++i) {
+            const UpArc& a = h.arcs[i];
+            if (a.to < 0 || a.to >= n || h.rank[a.to] <= h.rank[v]) return false;
+            if (i > h.offsets[v] && h.arcs[i - 1].to >= a.to) return false; // find_arc bisects
+            if (a.fw < 0 || a.bw < 0) return false;
+            // a shortcut bypasses a node ranked below both ends, so unpacking terminates
+            for (NodeId mid : { a.fw_mid, a.bw_mid })
+                if (mid != -1 && (mid < 0 || mid >= n || h.rank[mid] >= h.rank[v])) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+unsigned long long graph_fingerprint(const Graph& g) {
+    unsigned long long h = 1469598103934665603ULL;
+    auto mix = [&h](unsigned long long x) {
+        for (int i = 0; i < 8; ++i) { h ^= (x >> (i * 8)) & 0xff; h *= 1099511628211ULL; }
+    };
+    mix((unsigned long long)g.n);
+    for (int u = 0; u < g.n; ++u) {
+        mix((unsigned long long)g.offsets[u + 1]);
+        for (const auto& e : g.adj(u)) { mix((unsigned long long)e.to); mix((unsigned long long)e.w); }
+    }
+    return h;
+}
+
+ContractionHierarchy ContractionHierarchy::build(const Graph& g) {
+    ContractionHierarchy ch;
+    Contractor c(g);
+    ch.h_ = c.run(ch.shortcuts_);
+    ch.fingerprint_ = graph_fingerprint(g);
+    return ch;
+}
+
+bool ContractionHierarchy::save(const std::string& path) const {
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    if (!os) return false;
+    write_pod(os, kChMagic);
+    write_pod(os, kChFormat);
+    write_pod(os, fingerprint_);
+    write_pod(os, h_.n);
+    write_pod(os, shortcuts_);
+    int arc_count = (int)h_.arcs.size();
+    write_pod(os, arc_count);
+    for (int r : h_.rank) write_pod(os, r);
+    for (int o : h_.offsets) write_pod(os, o);
+    for (const auto& a : h_.arcs) {
+        write_pod(os, a.to); write_pod(os, a.fw); write_pod(os, a.bw);
+        write_pod(os, a.fw_mid); write_pod(os, a.bw_mid);
+    }
+    return (bool)os;
+}
+
+bool ContractionHierarchy::load(const std::string& path, const Graph& g, ContractionHierarchy& out) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) return false;
+    unsigned magic = 0, format = 0;
+    unsigned long long fp = 0;
+    int n = 0, shortcuts = 0, arc_count = 0;
+    if (!read_pod(is, magic) || magic != kChMagic) return false;
+    if (!read_pod(is, format) || format != kChFormat) return false;
+    if (!read_pod(is, fp) || fp != graph_fingerprint(g)) return false;
+    if (!read_pod(is, n) || n != g.n) return false;
+    if (!read_pod(is, shortcuts) || !read_pod(is, arc_count) || arc_count < 0) return false;
+    // the rest must be exactly the tables the header announces (guards the resizes below)
+    std::streamoff here = is.tellg();
+    is.seekg(0, std::ios::end);
+    std::streamoff rest = (std::streamoff)is.tellg() - here;
+    is.seekg(here);
+    const std::streamoff arc_bytes = 3 * sizeof(NodeId) + 2 * sizeof(long long);
+    if (rest != (std::streamoff)(2 * (long long)n + 1) * (std::streamoff)sizeof(int) + arc_count * arc_bytes) return false;
+
+    ContractionHierarchy ch;
+    ch.fingerprint_ = fp;
+    ch.shortcuts_ = shortcuts;
+    ch.h_.n = n;
+    ch.h_.rank.resize(n);
+    ch.h_.offsets.resize(n + 1);
+    ch.h_.arcs.resize(arc_count);
+    for (auto& r : ch.h_.rank) if (!read_pod(is, r)) return false;
+    for (auto& o : ch.h_.offsets) if (!read_pod(is, o)) return false;
+    for (auto& a : ch.h_.arcs) {
+        if (!read_pod(is, a.to) || !read_pod(is, a.fw) || !read_pod(is, a.bw) ||
+            !read_pod(is, a.fw_mid) || !read_pod(is, a.bw_mid)) return false;
+    }
+    if (!well_formed(ch.h_)) return false;
+    out = std::move(ch);
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "dijkstra.hpp"
+
+// Arc of an upward (hierarchy) graph. It is stored at its lower-ranked endpoint
+// and `to` always ranks higher. Both travel directions share the arc.
+struct UpArc {
+    NodeId to;
+    long long fw;   // cost owner -> to (INF if there is no such connection)
+    long long bw;   // cost to -> owner
+    NodeId fw_mid;  // node the fw shortcut bypasses (-1 = original edge)
+    NodeId bw_mid;
+};
+
+// Search graph shared by the CH and CCH query engines.
+struct UpwardGraph {
+    int n = 0;
+    std::vector<int> rank;      // rank[v] = position in contraction order
+    std::vector<int> offsets;   // size n+1, arcs of v are arcs[offsets[v] .. offsets[v+1])
+    std::vector<UpArc> arcs;    // sorted by `to` within each node
+
+    // arc between a and b (either order), nullptr if none
+    const UpArc* find_arc(NodeId a, NodeId b) const;
+};
+
+// Bidirectional upward search; the returned path is unpacked to original NodeIds.
+// `settled` (optional) receives the number of nodes settled by both searches.
+RouteResult upward_route(const UpwardGraph& h, int src, int dst, int* settled = nullptr,
+                         DijkstraWorkspace& ws = DijkstraWorkspace::local());
+
+// Contraction Hierarchy over a fixed metric (the Graph's own weights).
+class ContractionHierarchy {
+public:
+    // Orders nodes by edge difference and contracts them, inserting shortcuts
+    // wherever a bounded witness search finds no equally short detour.
+    static ContractionHierarchy build(const Graph& g);
+
+    // Binary dump / restore. load() rejects files built from a different graph, and
+    // truncated or inconsistent ones (the caller then rebuilds).
+    bool save(const std::string& path) const;
+    static bool load(const std::string& path, const Graph& g, ContractionHierarchy& out);
+
+    RouteResult route(int src, int dst, int* settled = nullptr) const {
+        return upward_route(h_, src, dst, settled);
+    }
+    int node_count() const { return h_.n; }
+    int shortcut_count() const { return shortcuts_; }
+    const UpwardGraph& upward() const { return h_; }
+
+private:
+    UpwardGraph h_;
+    unsigned long long fingerprint_ = 0;
+    int shortcuts_ = 0;
+};
+
+// FNV-1a over the graph's topology and weights; identifies which graph a
+// precomputed hierarchy belongs to.
+unsigned long long graph_fingerprint(const Graph& g);
@@ -0,0 +1,35 @@
+#include "change_notifier.hpp"
+#include <thread>
+
+unsigned long long ChangeNotifier::bump() {
+    unsigned long long v;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        v = ++version_;
+    }
+    cv_.notify_one();
+    return v;
+}
+
+unsigned long long ChangeNotifier::version() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return version_;
+}
+
+void ChangeNotifier::set_debounce(std::chrono::milliseconds debounce) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    debounce_ = debounce;
+}
+
+unsigned long long ChangeNotifier::wait_change(unsigned long long seen) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    cv_.wait(lk, [&] { return version_ > seen; });
+    if (debounce_.count() > 0) {
+        // later bumps in the window only raise version_; they do not extend the window
+        auto until = std::chrono::steady_clock::now() + debounce_;
+        lk.unlock();
+        std::this_thread::sleep_until(until);
+        lk.lock();
+    }
+    return version_;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// State-version counter for everything the /events stream reports (incidents, TransitDNA,
+// monitor alerts). Writers call bump() only after an actual change; the consumer sleeps
+// until the version advances, then waits out a short debounce window so a burst of
+// changes produces one wakeup.
+class ChangeNotifier {
+public:
+    explicit ChangeNotifier(std::chrono::milliseconds debounce = std::chrono::milliseconds(50))
+        : debounce_(debounce) {}
+
+    // Records one change and wakes the waiter. Returns the new version.
+    unsigned long long bump();
+    unsigned long long version();
+
+    void set_debounce(std::chrono::milliseconds debounce);
+
+    // Blocks until version() > seen, then for the rest of the debounce window counted
+    // from that first change. Returns the version at the end of the window.
+    unsigned long long wait_change(unsigned long long seen);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    unsigned long long version_ = 0;
+    std::chrono::milliseconds debounce_;
+};
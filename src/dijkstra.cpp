@@ -1,30 +1,231 @@
 #include "dijkstra.hpp"
+#include "pqueue.hpp"
 #include <queue>
 #include <algorithm>
 
-DijkstraResult dijkstra(const Graph& g, int src) {
+Graph GraphBuilder::build() const {
+    Graph g;
+    g.n = n_;
+    g.offsets.assign(n_ + 1, 0);
+    for (const auto& a : arcs_) g.offsets[a.from + 1]++;
+    for (int u = 0; u < n_; ++u) g.offsets[u + 1] += g.offsets[u];
+
+    // counting sort by source; stable so per-node edge order matches add_edge order
+    g.edges.resize(arcs_.size());
+    std::vector<int> cursor(g.offsets.begin(), g.offsets.end() - 1);
+    for (const auto& a : arcs_) {
+        g.edges[cursor[a.from]++] = { a.to, a.w };
+        g.max_weight = std::max(g.max_weight, a.w);
+    }
+
+    // transpose, built from the packed forward array so ids refer to g.edges
+    g.rev_offsets.assign(n_ + 1, 0);
+    for (const auto& e : g.edges) g.rev_offsets[e.to + 1]++;
+    for (int v = 0; v < n_; ++v) g.rev_offsets[v + 1] += g.rev_offsets[v];
+    g.rev_edges.resize(g.edges.size());
+    cursor.assign(g.rev_offsets.begin(), g.rev_offsets.end() - 1);
+    for (int u = 0; u < n_; ++u)
+        for (int i = g.offsets[u]; i < g.offsets[u + 1]; ++i)
+            g.rev_edges[cursor[g.edges[i].to]++] = { u, i };
+    return g;
+}
+
+// Queue follows the pqueue.hpp interface; WeightOf(i) yields the cost of g.edges[i]
+template <typename Queue, typename WeightOf>
+static DijkstraResult run_dijkstra(const Graph& g, int src, WeightOf weight_of, Queue& pq) {
     int n = g.n;
     std::vector<long long> dist(n, INF);
     std::vector<int> prev(n, -1);
     if (src < 0 || src >= n) return { dist, prev };
     dist[src] = 0;
-    using pli = std::pair<long long, int>;
-    std::priority_queue<pli, std::vector<pli>, std::greater<pli>> pq;
-    pq.push({ 0, src });
+    pq.reset(n);
+    pq.push(src, 0);
     while (!pq.empty()) {
-        auto [d, u] = pq.top(); pq.pop();
+        auto [d, u] = pq.pop();
         if (d != dist[u]) continue;
-        for (auto& e : g.adj[u]) {
-            if (dist[e.to] > dist[u] + e.w) {
-                dist[e.to] = dist[u] + e.w;
-                prev[e.to] = u;
-                pq.push({ dist[e.to], e.to });
+        for (int i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            NodeId v = g.edges[i].to;
+            long long nd = dist[u] + weight_of(i);
+            if (dist[v] > nd) {
+                dist[v] = nd;
+                prev[v] = u;
+                pq.push(v, nd);
             }
         }
     }
     return { dist, prev };
 }
 
+template <typename Queue>
+static Queue make_queue(long long) { return Queue(); }
+template <>
+DialQueue make_queue<DialQueue>(long long max_weight) { return DialQueue(max_weight); }
+
+template <typename Queue>
+DijkstraResult dijkstra_with(const Graph& g, int src) {
+    Queue pq = make_queue<Queue>(g.max_weight);
+    return run_dijkstra(g, src, [&g](int i) { return g.edges[i].w; }, pq);
+}
+
+template <typename Queue>
+DijkstraResult dijkstra_with(const Graph& g, int src, const EdgeWeights& w) {
+    if ((int)w.size() != g.edge_count()) return dijkstra_with<Queue>(g, src);
+    // overlays only raise weights; the Dial queue grows its window (or spills) if needed
+    Queue pq = make_queue<Queue>(g.max_weight);
+    return run_dijkstra(g, src, [&w](int i) { return w[i]; }, pq);
+}
+
+template DijkstraResult dijkstra_with<BinaryHeapQueue>(const Graph&, int);
+template DijkstraResult dijkstra_with<BinaryHeapQueue>(const Graph&, int, const EdgeWeights&);
+template DijkstraResult dijkstra_with<DialQueue>(const Graph&, int);
+template DijkstraResult dijkstra_with<DialQueue>(const Graph&, int, const EdgeWeights&);
+template DijkstraResult dijkstra_with<RadixHeapQueue>(const Graph&, int);
+template DijkstraResult dijkstra_with<RadixHeapQueue>(const Graph&, int, const EdgeWeights&);
+template DijkstraResult dijkstra_with<DaryHeapQueue<4>>(const Graph&, int);
+template DijkstraResult dijkstra_with<DaryHeapQueue<4>>(const Graph&, int, const EdgeWeights&);
+
+DijkstraResult dijkstra(const Graph& g, int src) {
+    return dijkstra_with<BinaryHeapQueue>(g, src);
+}
+
+DijkstraResult dijkstra(const Graph& g, int src, const EdgeWeights& w) {
+    return dijkstra_with<BinaryHeapQueue>(g, src, w);
+}
+
+DijkstraWorkspace& DijkstraWorkspace::local() {
+    thread_local DijkstraWorkspace ws;
+    return ws;
+}
+
+template <typename WeightOf>
+static RouteResult run_bidirectional(const Graph& g, int src, int dst, WeightOf weight_of, DijkstraWorkspace& ws) {
+    RouteResult out;
+    int n = g.n;
+    if (src < 0 || src >= n || dst < 0 || dst >= n) return out;
+
+    // fwd.prev = predecessor towards src, bwd.prev = next hop towards dst
+    SearchLabels& f = ws.fwd;
+    SearchLabels& b = ws.bwd;
+    f.reset(n); b.reset(n);
+    ws.qf.clear(); ws.qb.clear();
+    f.set(src, 0, -1); ws.qf.push(0, src);
+    b.set(dst, 0, -1); ws.qb.push(0, dst);
+    long long best = (src == dst) ? 0 : INF;
+    int meet = (src == dst) ? src : -1;
+
+    while (!ws.qf.empty() && !ws.qb.empty()) {
+        // no undiscovered path can beat `best` once the two frontiers add up to it
+        if (best != INF && ws.qf.top().first + ws.qb.top().first >= best) break;
+        if (ws.qf.top().first <= ws.qb.top().first) {
+            auto [d, u] = ws.qf.top(); ws.qf.pop();
+            if (d != f.dist(u)) continue;
+            for (int i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+                NodeId v = g.edges[i].to;
+                long long nd = d + weight_of(i);
+                if (nd < f.dist(v)) { f.set(v, nd, u); ws.qf.push(nd, v); }
+                long long dv = b.dist(v);
+                if (dv != INF && nd + dv < best) { best = nd + dv; meet = v; }
+            }
+        }
+        else {
+            auto [d, v] = ws.qb.top(); ws.qb.pop();
+            if (d != b.dist(v)) continue;
+            for (const auto& ie : g.in(v)) {
+                NodeId u = ie.from;
+                long long nd = d + weight_of(ie.id);
+                if (nd < b.dist(u)) { b.set(u, nd, v); ws.qb.push(nd, u); }
+                long long du = f.dist(u);
+                if (du != INF && nd + du < best) { best = nd + du; meet = u; }
+            }
+        }
+    }
+    if (meet < 0) return out;
+
+    // stitch src..meet (forward tree) and meet..dst (backward tree)
+    for (int v = meet; v != -1; v = f.prev(v)) out.path.push_back(v);
+    std::reverse(out.path.begin(), out.path.end());
+    for (int v = b.prev(meet); v != -1; v = b.prev(v)) out.path.push_back(v);
+    out.arrival.reserve(out.path.size());
+    out.arrival.push_back(0);
+    for (size_t k = 1; k < out.path.size(); ++k) {
+        long long hop = INF;
+        for (int i = g.offsets[out.path[k - 1]]; i < g.offsets[out.path[k - 1] + 1]; ++i)
+            if (g.edges[i].to == out.path[k]) hop = std::min(hop, weight_of(i));
+        out.arrival.push_back(out.arrival.back() + hop);
+    }
+    out.dist = out.arrival.back();
+    return out;
+}
+
+RouteResult route_p2p(const Graph& g, int src, int dst, DijkstraWorkspace& ws) {
+    return run_bidirectional(g, src, dst, [&g](int i) { return g.edges[i].w; }, ws);
+}
+
+RouteResult route_p2p(const Graph& g, int src, int dst, const EdgeWeights& w, DijkstraWorkspace& ws) {
+    if ((int)w.size() != g.edge_count()) return route_p2p(g, src, dst, ws);
+    return run_bidirectional(g, src, dst, [&w](int i) { return w[i]; }, ws);
+}
+
+template <typename WeightOf>
+static std::vector<RouteResult> run_to_targets(const Graph& g, int src, const std::vector<NodeId>& targets,
+                                               WeightOf weight_of, DijkstraWorkspace& ws) {
+    std::vector<RouteResult> out(targets.size());
+    int n = g.n;
+    if (src < 0 || src >= n) return out;
+
+    // aux.dist(t) == 1 marks a target that is not settled yet
+    SearchLabels& lab = ws.fwd;
+    SearchLabels& pending = ws.aux;
+    lab.reset(n);
+    pending.reset(n);
+    int left = 0;
+    for (NodeId t : targets) {
+        if (t < 0 || t >= n || pending.dist(t) != INF) continue;
+        pending.set(t, 1, -1);
+        ++left;
+    }
+
+    ReusableHeap& pq = ws.qf;
+    pq.clear();
+    lab.set(src, 0, -1);
+    pq.push(0, src);
+    while (left > 0 && !pq.empty()) {
+        auto [d, u] = pq.top(); pq.pop();
+        if (d != lab.dist(u)) continue;
+        if (pending.dist(u) == 1) { pending.set(u, 0, -1); --left; }
+        for (int i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            NodeId v = g.edges[i].to;
+            long long nd = d + weight_of(i);
+            if (nd < lab.dist(v)) { lab.set(v, nd, u); pq.push(nd, v); }
+        }
+    }
+
+    for (size_t k = 0; k < targets.size(); ++k) {
+        NodeId t = targets[k];
+        // settled targets are final; anything else is unreachable
+        if (t < 0 || t >= n || pending.dist(t) != 0) continue;
+        RouteResult& r = out[k];
+        for (int v = t; v != -1; v = lab.prev(v)) {
+            r.path.push_back(v);
+            r.arrival.push_back(lab.dist(v));
+        }
+        std::reverse(r.path.begin(), r.path.end());
+        std::reverse(r.arrival.begin(), r.arrival.end());
+        r.dist = lab.dist(t);
+    }
+    return out;
+}
+
+std::vector<RouteResult> route_to_targets(const Graph& g, int src, const std::vector<NodeId>& targets, DijkstraWorkspace& ws) {
+    return run_to_targets(g, src, targets, [&g](int i) { return g.edges[i].w; }, ws);
+}
+
+std::vector<RouteResult> route_to_targets(const Graph& g, int src, const std::vector<NodeId>& targets,
+                                          const EdgeWeights& w, DijkstraWorkspace& ws) {
+    if ((int)w.size() != g.edge_count()) return route_to_targets(g, src, targets, ws);
+    return run_to_targets(g, src, targets, [&w](int i) { return w[i]; }, ws);
+}
+
 std::vector<int> recover_path(const DijkstraResult& res, int src, int dest) {
     std::vector<int> path;
     if (dest < 0 || dest >= (int)res.dist.size()) return path;
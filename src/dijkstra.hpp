@@ -2,27 +2,161 @@
 #include <vector>
 #include <limits>
 #include <utility>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
 
 using NodeId = int;
 const long long INF = std::numeric_limits<long long>::max();
 
 struct Edge { NodeId to; long long w; };
 
+// Reverse-graph entry: `from` -> v is edges[id] of the forward graph.
+struct InEdge { NodeId from; int id; };
+
+// View over one node's slice of a contiguous CSR array.
+template <typename T>
+struct Slice {
+    const T* first = nullptr;
+    const T* last = nullptr;
+    const T* begin() const { return first; }
+    const T* end() const { return last; }
+    std::size_t size() const { return (std::size_t)(last - first); }
+    bool empty() const { return first == last; }
+};
+using EdgeRange = Slice<Edge>;
+using InEdgeRange = Slice<InEdge>;
+
+// Immutable CSR graph: the out-edges of u are edges[offsets[u] .. offsets[u+1]).
+// The transpose is kept alongside so incoming edges of v are rev_edges[rev_offsets[v] ..
+// rev_offsets[v+1]), each pointing back at its forward edge id.
+// Build it with GraphBuilder; copying is a handful of allocations regardless of n.
 struct Graph {
     int n = 0;
-    std::vector<std::vector<Edge>> adj;
-    Graph() = default;
-    Graph(int n_) : n(n_), adj(n_) {}
+    std::vector<int> offsets;       // size n+1
+    std::vector<Edge> edges;        // grouped by source node, insertion order kept
+    std::vector<int> rev_offsets;   // size n+1
+    std::vector<InEdge> rev_edges;  // grouped by target node
+    long long max_weight = 0;
+
+    EdgeRange adj(NodeId u) const {
+        const Edge* base = edges.data();
+        return { base + offsets[u], base + offsets[u + 1] };
+    }
+    InEdgeRange in(NodeId v) const {
+        const InEdge* base = rev_edges.data();
+        return { base + rev_offsets[v], base + rev_offsets[v + 1] };
+    }
+    int edge_count() const { return (int)edges.size(); }
+};
+
+// Collects add_edge calls and packs them into a Graph.
+class GraphBuilder {
+public:
+    explicit GraphBuilder(int n) : n_(n) {}
     void add_edge(int u, int v, long long w) {
-        if (u >= (int)adj.size() || v >= (int)adj.size()) return;
-        adj[u].push_back({ v,w });
+        if (u < 0 || v < 0 || u >= n_ || v >= n_) return;
+        arcs_.push_back({ u, v, w });
     }
+    Graph build() const;
+
+private:
+    struct Arc { NodeId from; NodeId to; long long w; };
+    int n_;
+    std::vector<Arc> arcs_;
 };
 
+// Per-edge weights indexed like Graph::edges. Lets a search run against the
+// shared base graph with adjusted costs instead of a mutated copy.
+using EdgeWeights = std::vector<long long>;
+
 struct DijkstraResult {
     std::vector<long long> dist;
     std::vector<int> prev;
 };
 
+// One-to-all search on a binary heap.
 DijkstraResult dijkstra(const Graph& g, int src);
+DijkstraResult dijkstra(const Graph& g, int src, const EdgeWeights& w);
+
+// Compile-time queue choice; instantiated for the queues in pqueue.hpp.
+template <typename Queue>
+DijkstraResult dijkstra_with(const Graph& g, int src);
+template <typename Queue>
+DijkstraResult dijkstra_with(const Graph& g, int src, const EdgeWeights& w);
+
 std::vector<int> recover_path(const DijkstraResult& res, int src, int dest);
+
+// ---------------- reusable search state ----------------
+
+// dist/prev per node, invalidated in O(1) by bumping a generation counter, so a
+// query only pays for the nodes it actually reaches.
+class SearchLabels {
+public:
+    void reset(int n) {
+        if ((int)stamp_.size() < n) {
+            dist_.resize(n);
+            prev_.resize(n);
+            stamp_.resize(n, 0);
+        }
+        if (++gen_ == 0) { // wrapped: old stamps could alias, clear them once
+            std::fill(stamp_.begin(), stamp_.end(), 0u);
+            gen_ = 1;
+        }
+    }
+    long long dist(NodeId v) const { return stamp_[v] == gen_ ? dist_[v] : INF; }
+    int prev(NodeId v) const { return stamp_[v] == gen_ ? prev_[v] : -1; }
+    void set(NodeId v, long long d, int p) { dist_[v] = d; prev_[v] = p; stamp_[v] = gen_; }
+
+private:
+    std::vector<long long> dist_;
+    std::vector<int> prev_;
+    std::vector<unsigned> stamp_;
+    unsigned gen_ = 0;
+};
+
+// Min-heap of (key, node) whose buffer survives between queries.
+class ReusableHeap {
+public:
+    void clear() { items_.clear(); }
+    bool empty() const { return items_.empty(); }
+    void push(long long key, int v) {
+        items_.push_back({ key, v });
+        std::push_heap(items_.begin(), items_.end(), std::greater<std::pair<long long, int>>());
+    }
+    const std::pair<long long, int>& top() const { return items_.front(); }
+    void pop() {
+        std::pop_heap(items_.begin(), items_.end(), std::greater<std::pair<long long, int>>());
+        items_.pop_back();
+    }
+
+private:
+    std::vector<std::pair<long long, int>> items_;
+};
+
+// Scratch space for point-to-point searches. Use local() to get the calling
+// thread's instance (one per httplib worker); a workspace serves one query at a time.
+struct DijkstraWorkspace {
+    SearchLabels fwd, bwd, aux;   // aux: per-search extras (A* potentials, path positions)
+    ReusableHeap qf, qb;
+    static DijkstraWorkspace& local();
+};
+
+// Point-to-point answer without any n-sized arrays.
+struct RouteResult {
+    long long dist = INF;             // INF if dst is unreachable
+    std::vector<NodeId> path;         // src .. dst, empty if unreachable
+    std::vector<long long> arrival;   // cost from src to path[i]
+};
+
+// Point-to-point query: searches forward from src and backward from dst over the
+// reverse index until the frontiers meet.
+RouteResult route_p2p(const Graph& g, int src, int dst, DijkstraWorkspace& ws = DijkstraWorkspace::local());
+RouteResult route_p2p(const Graph& g, int src, int dst, const EdgeWeights& w, DijkstraWorkspace& ws = DijkstraWorkspace::local());
+
+// Forward search from src that stops as soon as every target is settled. Returns one
+// route per entry of `targets`, in the same order (duplicates allowed).
+std::vector<RouteResult> route_to_targets(const Graph& g, int src, const std::vector<NodeId>& targets,
+                                          DijkstraWorkspace& ws = DijkstraWorkspace::local());
+std::vector<RouteResult> route_to_targets(const Graph& g, int src, const std::vector<NodeId>& targets,
+                                          const EdgeWeights& w, DijkstraWorkspace& ws = DijkstraWorkspace::local());
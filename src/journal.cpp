@@ -0,0 +1,330 @@
+#include "journal.hpp"
+#include <iostream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+
+namespace {
+
+const char kSnapshotMagic[8] = { 'T', 'G', 'S', 'N', 'A', 'P', '0', '1' };
+const size_t kFrameHeader = 8;          // u32 length + u32 crc32
+const size_t kRecordHeader = 9;         // u8 type + u64 seq
+const size_t kSnapshotFlushBytes = 1u << 20;
+
+uint32_t crc32(const char* data, size_t n) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i) c = table[(c ^ (uint8_t)data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+void append_frame(std::string& out, Journal::Type type, unsigned long long seq, const std::string& body) {
+    uint32_t len = (uint32_t)(kRecordHeader + body.size());
+    size_t at = out.size();
+    out.resize(at + kFrameHeader + len);
+    char* rec = &out[at + kFrameHeader];
+    rec[0] = (char)type;
+    std::memcpy(rec + 1, &seq, sizeof(seq));
+    std::memcpy(rec + kRecordHeader, body.data(), body.size());
+    uint32_t crc = crc32(rec, len);
+    std::memcpy(&out[at], &len, sizeof(len));
+    std::memcpy(&out[at + 4], &crc, sizeof(crc));
+}
+
+// Calls fn(type, seq, body, size) for each intact frame; returns the offset after the
+// last one (a torn or corrupt frame ends the scan).
+template <typename Fn>
+size_t scan_frames(const char* data, size_t size, Fn&& fn) {
+    size_t off = 0;
+    while (size - off >= kFrameHeader) {
+        uint32_t len, crc;
+        std::memcpy(&len, data + off, sizeof(len));
+        std::memcpy(&crc, data + off + 4, sizeof(crc));
+        if (len < kRecordHeader || len > size - off - kFrameHeader) break;
+        const char* rec = data + off + kFrameHeader;
+        if (crc32(rec, len) != crc) break;
+        unsigned long long seq;
+        std::memcpy(&seq, rec + 1, sizeof(seq));
+        fn((Journal::Type)(uint8_t)rec[0], seq, rec + kRecordHeader, (size_t)len - kRecordHeader);
+        off += kFrameHeader + len;
+    }
+    return off;
+}
+
+// Read-only mapping of a whole file; empty if it does not exist.
+struct Mapped {
+    const char* data = nullptr;
+    size_t size = 0;
+    explicit Mapped(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+                data = (const char*)p;
+                size = (size_t)st.st_size;
+            }
+        }
+        ::close(fd);
+    }
+    ~Mapped() { if (data) munmap((void*)data, size); }
+    Mapped(const Mapped&) = delete;
+    Mapped& operator=(const Mapped&) = delete;
+};
+
+bool write_all(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+void sync_dir(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+    fsync(fd);
+    ::close(fd);
+}
+
+bool exists(const std::string& path) {
+    return ::access(path.c_str(), F_OK) == 0;
+}
+
+// Writes the state produced by `capture` as snapshot.bin (via a temp file and rename).
+bool write_snapshot(const std::string& dir, unsigned long long seq, const Journal::CaptureFn& capture) {
+    std::string tmp = dir + "/snapshot.tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    std::string buf(kSnapshotMagic, sizeof(kSnapshotMagic));
+    buf.append((const char*)&seq, sizeof(seq));
+    bool ok = true;
+    capture([&](Journal::Type type, const Journal::Encoder& body) {
+        append_frame(buf, type, seq, body.bytes());
+        if (buf.size() >= kSnapshotFlushBytes) {
+            ok = ok && write_all(fd, buf.data(), buf.size());
+            buf.clear();
+        }
+    });
+    ok = ok && write_all(fd, buf.data(), buf.size()) && fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), (dir + "/snapshot.bin").c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    sync_dir(dir);
+    return true;
+}
+
+} // namespace
+
+bool Journal::open(const std::string& dir, const ApplyFn& apply, CaptureFn capture, size_t compact_bytes) {
+    dir_ = dir;
+    capture_ = std::move(capture);
+    compact_bytes_ = compact_bytes;
+    if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "[journal] cannot create " << dir << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    // snapshot first, then the rotated log (if a compaction was cut short), then the live log
+    unsigned long long snapshot_seq = 0, last_seq = 0;
+    recovered_ = 0;
+    auto replay = [&](Type type, unsigned long long seq, const char* body, size_t n) {
+        if (seq <= snapshot_seq) return;
+        Decoder d(body, n);
+        apply(type, d);
+        last_seq = seq;
+        ++recovered_;
+    };
+    {
+        Mapped snap(dir + "/snapshot.bin");
+        size_t head = sizeof(kSnapshotMagic) + sizeof(snapshot_seq);
+        if (snap.size >= head && std::memcmp(snap.data, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0) {
+            std::memcpy(&snapshot_seq, snap.data + sizeof(kSnapshotMagic), sizeof(snapshot_seq));
+            scan_frames(snap.data + head, snap.size - head, [&](Type type, unsigned long long, const char* body, size_t n) {
+                Decoder d(body, n);
+                apply(type, d);
+                ++recovered_;
+            });
+        }
+    }
+    bool leftover = exists(dir + "/wal.old");
+    if (leftover) {
+        Mapped old(dir + "/wal.old");
+        scan_frames(old.data, old.size, replay);
+    }
+    std::string log_path = dir + "/wal.log";
+    size_t valid = 0;
+    {
+        Mapped log(log_path);
+        valid = scan_frames(log.data, log.size, replay);
+        if (valid < log.size) {
+            std::cerr << "[journal] dropping " << (log.size - valid) << " bytes of torn log tail\n";
+            if (::truncate(log_path.c_str(), (off_t)valid) != 0) return false;
+        }
+    }
+    next_seq_ = durable_seq_ = std::max(snapshot_seq, last_seq);
+
+    fd_ = ::open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "[journal] cannot open " << log_path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    log_bytes_ = valid;
+
+    // a compaction did not finish: everything is in memory now, so fold both logs away
+    if (leftover && capture_ && write_snapshot(dir_, next_seq_, capture_)) {
+        ::unlink((dir_ + "/wal.old").c_str());
+        if (ftruncate(fd_, 0) == 0) log_bytes_ = 0;
+        sync_dir(dir_);
+    }
+
+    open_ = true;
+    writer_ = std::thread([this]() { run_writer(); });
+    return true;
+}
+
+Journal::~Journal() {
+    if (!writer_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_one();
+    writer_.join();
+    std::unique_lock<std::mutex> lk(mutex_);
+    durable_cv_.wait(lk, [&] { return !compacting_; });
+    ::close(fd_);
+}
+
+unsigned long long Journal::append(Type type, const Encoder& body) {
+    if (!open_) return 0;
+    unsigned long long seq;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        seq = ++next_seq_;
+        if (failed_) return seq; // never durable: sync(seq) throws
+        append_frame(pending_, type, seq, body.bytes());
+    }
+    work_cv_.notify_one();
+    return seq;
+}
+
+void Journal::sync(unsigned long long seq) {
+    if (seq == 0) return;
+    std::unique_lock<std::mutex> lk(mutex_);
+    durable_cv_.wait(lk, [&] { return durable_seq_ >= seq || failed_; });
+    if (durable_seq_ < seq) throw std::runtime_error("journal write failed; change not persisted");
+}
+
+void Journal::run_writer() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+        work_cv_.wait(lk, [&] { return !pending_.empty() || stopping_; });
+        if (pending_.empty()) return;
+        std::string batch;
+        batch.swap(pending_);
+        unsigned long long last = next_seq_;
+        int fd = fd_;
+        size_t good = log_bytes_;
+        lk.unlock();
+        // everything appended meanwhile waits for the next batch: one fsync per batch
+        bool ok = write_all(fd, batch.data(), batch.size()) && fdatasync(fd) == 0;
+        if (!ok) {
+            // after a failed fsync the page cache cannot be trusted: cut the log back to
+            // the last synced frame and refuse everything from here on
+            std::cerr << "[journal] write failed, persistence stopped: " << std::strerror(errno) << "\n";
+            if (ftruncate(fd, (off_t)good) != 0 || fdatasync(fd) != 0)
+                std::cerr << "[journal] could not cut the log back to " << good << " bytes\n";
+        }
+        lk.lock();
+        if (!ok) {
+            failed_ = true;
+            pending_.clear();
+            durable_cv_.notify_all();
+            continue;
+        }
+        durable_seq_ = last;
+        log_bytes_ += batch.size();
+        durable_cv_.notify_all();
+        if (capture_ && !compacting_ && !stopping_ && log_bytes_ >= compact_bytes_ && rotate()) {
+            compacting_ = true;
+            std::thread([this, last]() { compact(last); }).detach();
+        }
+    }
+}
+
+// mutex_ held, called by the writer between batches: wal.log becomes wal.old, which
+// holds exactly the records up to the last durable one.
+bool Journal::rotate() {
+    std::string log_path = dir_ + "/wal.log", old_path = dir_ + "/wal.old";
+    if (exists(old_path)) return false; // a failed compaction left it; never overwrite
+    if (::rename(log_path.c_str(), old_path.c_str()) != 0) return false;
+    int fd = ::open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ::rename(old_path.c_str(), log_path.c_str());
+        return false;
+    }
+    ::close(fd_);
+    fd_ = fd;
+    log_bytes_ = 0;
+    sync_dir(dir_);
+    return true;
+}
+
+// Runs on its own thread; records up to `upto` are applied to the state `capture_`
+// reads, later ones may or may not be (replaying them again is harmless).
+void Journal::compact(unsigned long long upto) {
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = write_snapshot(dir_, upto, capture_);
+    if (ok) {
+        ::unlink((dir_ + "/wal.old").c_str());
+        sync_dir(dir_);
+    }
+    else {
+        std::cerr << "[journal] snapshot failed; keeping wal.old\n";
+    }
+    std::cout << "[journal] snapshot at seq " << upto << " took "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count() << " ms\n";
+    std::lock_guard<std::mutex> lk(mutex_);
+    compacting_ = false;
+    durable_cv_.notify_all();
+}
+
+#else
+
+Journal::~Journal() {}
+
+bool Journal::open(const std::string& dir, const ApplyFn&, CaptureFn, size_t) {
+    std::cerr << "[journal] persistence in " << dir << " is only available on Linux\n";
+    return false;
+}
+
+unsigned long long Journal::append(Type, const Encoder&) { return 0; }
+
+void Journal::sync(unsigned long long) {}
+
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Append-only write-ahead log plus compacted snapshots, in one data directory:
+//   wal.log       framed records: u32 length, u32 crc32, u8 type, u64 seq, body
+//   snapshot.bin  "TGSNAP01", u64 seq, then the same frames describing the full state
+//   wal.old       the previous log while a snapshot is being written
+//
+// Records must be idempotent "put" / "remove" operations keyed by id, and must be
+// appended under the lock that guards the change they describe (so log order matches
+// mutation order). A fuzzy snapshot followed by the log tail then replays to the
+// exact state.
+//
+// append() only copies into a buffer. One writer thread writes whatever accumulated
+// and fdatasync()s once, so concurrent writers share an fsync (group commit);
+// sync(seq) waits for that. Once the log outgrows the compaction threshold it is
+// rotated and the state is snapshotted from the capture callback on a side thread.
+//
+// A failed write or fsync stops the journal for good: the log is cut back to the last
+// synced frame and every later sync() throws.
+//
+// Linux / POSIX only; open() returns false elsewhere and the journal stays disabled
+// (append() returns 0, sync() returns at once).
+class Journal {
+public:
+    enum class Type : uint8_t {
+        IncidentPut = 1,
+        IncidentRemove = 2,
+        TripPut = 3,
+        MonitorPut = 4,
+        PersonaPut = 5,
+        CalendarSet = 6
+    };
+
+    // Little-endian record bodies.
+    class Encoder {
+    public:
+        Encoder& i32(int32_t v) { return raw(&v, sizeof(v)); }
+        Encoder& i64(int64_t v) { return raw(&v, sizeof(v)); }
+        Encoder& str(const std::string& s) {
+            i32((int32_t)s.size());
+            buf_.append(s);
+            return *this;
+        }
+        const std::string& bytes() const { return buf_; }
+
+    private:
+        Encoder& raw(const void* p, size_t n) {
+            buf_.append((const char*)p, n);
+            return *this;
+        }
+        std::string buf_;
+    };
+
+    // Reads a body; a short body sets ok() to false and yields zeros.
+    class Decoder {
+    public:
+        Decoder(const char* p, size_t n) : p_(p), end_(p + n) {}
+        int32_t i32() { int32_t v = 0; raw(&v, sizeof(v)); return v; }
+        int64_t i64() { int64_t v = 0; raw(&v, sizeof(v)); return v; }
+        std::string str() {
+            int32_t n = i32();
+            if (n < 0 || end_ - p_ < n) { ok_ = false; return std::string(); }
+            std::string s(p_, (size_t)n);
+            p_ += n;
+            return s;
+        }
+        bool ok() const { return ok_; }
+
+    private:
+        void raw(void* out, size_t n) {
+            if ((size_t)(end_ - p_) < n) { ok_ = false; return; }
+            std::memcpy(out, p_, n);
+            p_ += n;
+        }
+        const char* p_;
+        const char* end_;
+        bool ok_ = true;
+    };
+
+    using ApplyFn = std::function<void(Type, Decoder&)>;
+    using PutFn = std::function<void(Type, const Encoder&)>;
+    using CaptureFn = std::function<void(const PutFn&)>; // emits the full current state
+
+    Journal() = default;
+    ~Journal(); // writes out what is pending and waits for a running snapshot
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Replays snapshot.bin and the log tail through `apply` (a torn tail is cut off),
+    // then starts the writer. `capture` must be callable from another thread.
+    bool open(const std::string& dir, const ApplyFn& apply, CaptureFn capture,
+              size_t compact_bytes = 64u << 20);
+
+    // Queues one record and returns its sequence number (0 when disabled).
+    unsigned long long append(Type type, const Encoder& body);
+
+    // Blocks until every record up to `seq` is on disk; throws std::runtime_error if
+    // the journal failed before that (the change stays in memory only).
+    void sync(unsigned long long seq);
+
+    // Records replayed by the last open(), for logging.
+    size_t recovered() const { return recovered_; }
+
+private:
+    void run_writer();
+    void compact(unsigned long long upto);
+    bool rotate();
+
+    std::string dir_;
+    CaptureFn capture_;
+    size_t compact_bytes_ = 0;
+    size_t recovered_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;      // writer: something to write
+    std::condition_variable durable_cv_;   // sync(): a batch reached the disk
+    std::atomic<bool> open_{ false };
+    int fd_ = -1;                          // wal.log; owned by the writer once running
+    std::string pending_;                  // frames not yet handed to the writer
+    unsigned long long next_seq_ = 0;      // last sequence number handed out
+    unsigned long long durable_seq_ = 0;   // last sequence number on disk
+    size_t log_bytes_ = 0;                 // size of wal.log
+    bool compacting_ = false;
+    bool stopping_ = false;
+    bool failed_ = false;                  // a write or fsync failed; nothing more is durable
+    std::thread writer_;
+};
@@ -0,0 +1,71 @@
+#include "matrix.hpp"
+#include <algorithm>
+
+// Settles the whole upward search space of `root`, appending (node, dist) pairs.
+// forward: follows arc.fw (root -> higher); otherwise arc.bw (higher -> root).
+static void upward_space(const UpwardGraph& h, NodeId root, bool forward, DijkstraWorkspace& ws,
+                         std::vector<std::pair<NodeId, long long>>& out) {
+    out.clear();
+    SearchLabels& lab = ws.fwd;
+    ReusableHeap& pq = ws.qf;
+    lab.reset(h.n);
+    pq.clear();
+    lab.set(root, 0, -1);
+    pq.push(0, root);
+    while (!pq.empty()) {
+        auto [d, u] = pq.top(); pq.pop();
+        if (d != lab.dist(u)) continue;
+        out.push_back({ u, d });
+        for (int i = h.offsets[u]; i < h.offsets[u + 1]; ++i) {
+            const UpArc& arc = h.arcs[i];
+            long long w = forward ? arc.fw : arc.bw;
+            if (w == INF) continue;
+            long long nd = d + w;
+            if (nd < lab.dist(arc.to)) { lab.set(arc.to, nd, u); pq.push(nd, arc.to); }
+        }
+    }
+}
+
+DistanceTable::DistanceTable(const UpwardGraph& h, const std::vector<NodeId>& targets)
+    : h_(&h), targets_(targets.size()) {
+    int n = h.n;
+    DijkstraWorkspace& ws = DijkstraWorkspace::local();
+
+    // collect every (node, target, dist) triple, then pack them per node
+    std::vector<std::pair<NodeId, long long>> space;
+    std::vector<std::pair<NodeId, Entry>> found;
+    for (size_t j = 0; j < targets.size(); ++j) {
+        NodeId t = targets[j];
+        if (t < 0 || t >= n) continue;
+        upward_space(h, t, false, ws, space);
+        for (const auto& [v, d] : space) found.push_back({ v, Entry{ (int)j, d } });
+    }
+
+    offsets_.assign(n + 1, 0);
+    for (const auto& f : found) ++offsets_[f.first + 1];
+    for (int v = 0; v < n; ++v) offsets_[v + 1] += offsets_[v];
+    entries_.resize(found.size());
+    std::vector<int> fill(offsets_.begin(), offsets_.end() - 1);
+    for (const auto& f : found) entries_[fill[f.first]++] = f.second;
+}
+
+void DistanceTable::fill_row(NodeId src, long long* row, DijkstraWorkspace& ws) const {
+    std::fill(row, row + targets_, INF);
+    if (src < 0 || src >= h_->n) return;
+    std::vector<std::pair<NodeId, long long>> space;
+    upward_space(*h_, src, true, ws, space);
+    for (const auto& [u, d] : space) {
+        for (int i = offsets_[u]; i < offsets_[u + 1]; ++i) {
+            const Entry& e = entries_[i];
+            if (d + e.dist < row[e.target]) row[e.target] = d + e.dist;
+        }
+    }
+}
+
+std::vector<long long> many_to_many(const UpwardGraph& h, const std::vector<NodeId>& sources,
+                                    const std::vector<NodeId>& targets) {
+    DistanceTable table(h, targets);
+    std::vector<long long> out(sources.size() * targets.size());
+    for (size_t i = 0; i < sources.size(); ++i) table.fill_row(sources[i], out.data() + i * targets.size());
+    return out;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include "ch.hpp"
+
+// Many-to-many distances over an upward graph (baseline CH or a customized CCH).
+// A backward upward search from every target drops (target, dist) entries into
+// buckets at the nodes it settles; a forward upward search from a source then
+// scans the buckets it meets. d(s,t) is the best meeting over all common nodes.
+class DistanceTable {
+public:
+    // Runs the backward searches. `h` must outlive the table.
+    DistanceTable(const UpwardGraph& h, const std::vector<NodeId>& targets);
+
+    // row[j] = d(src, targets[j]) for every target, INF if unreachable.
+    void fill_row(NodeId src, long long* row, DijkstraWorkspace& ws = DijkstraWorkspace::local()) const;
+
+private:
+    struct Entry { int target; long long dist; };
+
+    const UpwardGraph* h_;
+    size_t targets_ = 0;
+    std::vector<int> offsets_;     // size n+1, bucket of v is entries_[offsets_[v] .. offsets_[v+1])
+    std::vector<Entry> entries_;
+};
+
+// Full table, row-major: out[i * targets.size() + j] = d(sources[i], targets[j]).
+std::vector<long long> many_to_many(const UpwardGraph& h, const std::vector<NodeId>& sources,
+                                    const std::vector<NodeId>& targets);
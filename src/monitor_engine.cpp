@@ -0,0 +1,167 @@
+#include "monitor_engine.hpp"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+
+static long long now_epoch() {
+    return (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+}
+
+void MonitorEngine::start(const Graph& g, Store& store, std::function<void()> on_publish) {
+    graph_ = &g;
+    store_ = &store;
+    on_publish_ = std::move(on_publish);
+    std::thread([this]() { run(); }).detach();
+}
+
+static Journal::Encoder encode(const Monitor& m) {
+    Journal::Encoder e;
+    e.i32(m.id).i32(m.src).i32(m.dst).i32(m.threshold_minutes).i64(m.created_at);
+    return e;
+}
+
+int MonitorEngine::add(Monitor m) {
+    unsigned long long seq = 0;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        m.id = next_id_++;
+        m.created_at = now_epoch();
+        monitors_.push_back(m);
+        ++monitors_version_;
+        poked_ = true;
+        if (journal_) seq = journal_->append(Journal::Type::MonitorPut, encode(m));
+    }
+    cv_.notify_one();
+    if (journal_) journal_->sync(seq);
+    return m.id;
+}
+
+void MonitorEngine::attach_journal(Journal* journal) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    journal_ = journal;
+}
+
+void MonitorEngine::replay(Journal::Decoder& d) {
+    Monitor m;
+    m.id = d.i32();
+    m.src = d.i32();
+    m.dst = d.i32();
+    m.threshold_minutes = d.i32();
+    m.created_at = d.i64();
+    if (!d.ok()) return;
+    std::lock_guard<std::mutex> lk(mutex_);
+    bool replaced = false;
+    for (auto& existing : monitors_) {
+        if (existing.id == m.id) { existing = m; replaced = true; }
+    }
+    if (!replaced) monitors_.push_back(m);
+    if (m.id >= next_id_) next_id_ = m.id + 1;
+    ++monitors_version_;
+    poked_ = true;
+}
+
+void MonitorEngine::capture(const Journal::PutFn& put) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (const auto& m : monitors_) put(Journal::Type::MonitorPut, encode(m));
+}
+
+std::vector<Monitor> MonitorEngine::list() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return monitors_;
+}
+
+void MonitorEngine::poke() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        poked_ = true;
+    }
+    cv_.notify_one();
+}
+
+std::shared_ptr<const MonitorAlerts> MonitorEngine::alerts() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return alerts_;
+}
+
+void MonitorEngine::run() {
+    unsigned long long seen_version = 0;
+    bool first = true;
+    std::shared_ptr<const PenaltyOverlay> seen_overlay;
+    while (true) {
+        std::vector<Monitor> monitors;
+        unsigned long long version;
+        {
+            // woken by every monitor change and every rebuilt overlay; idle otherwise
+            std::unique_lock<std::mutex> lk(mutex_);
+            cv_.wait(lk, [this] { return poked_; });
+            poked_ = false;
+            monitors = monitors_;
+            version = monitors_version_;
+        }
+        try {
+            auto overlay = penalties_.current(); // its cache pokes us once it catches up
+            bool monitors_changed = first || version != seen_version;
+            if (!monitors_changed && overlay == seen_overlay) continue;
+            evaluate(monitors, *overlay, monitors_changed);
+            seen_version = version;
+            seen_overlay = overlay;
+            first = false;
+            if (on_publish_) on_publish_();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[monitors] exception: " << e.what() << "\n";
+        }
+    }
+}
+
+void MonitorEngine::evaluate(const std::vector<Monitor>& monitors, const PenaltyOverlay& overlay, bool monitors_changed) {
+    const Graph& g = *graph_;
+
+    // src -> indices into monitors
+    std::map<int, std::vector<size_t>> by_src;
+    for (size_t i = 0; i < monitors.size(); ++i) {
+        const Monitor& m = monitors[i];
+        if (m.src < 0 || m.dst < 0 || m.src >= g.n || m.dst >= g.n) continue;
+        by_src[m.src].push_back(i);
+    }
+
+    // baseline ETAs only depend on the monitor set
+    if (monitors_changed) eta_base_.assign(monitors.size(), -1);
+    std::vector<long long> eta_adj(monitors.size(), -1);
+    std::vector<NodeId> dsts;
+    for (const auto& [src, idx] : by_src) {
+        dsts.clear();
+        for (size_t i : idx) dsts.push_back(monitors[i].dst);
+        if (monitors_changed) {
+            auto base = route_to_targets(g, src, dsts);
+            for (size_t k = 0; k < idx.size(); ++k) eta_base_[idx[k]] = (base[k].dist == INF) ? -1 : base[k].dist;
+        }
+        auto adj = route_to_targets(g, src, dsts, overlay.w);
+        for (size_t k = 0; k < idx.size(); ++k) eta_adj[idx[k]] = (adj[k].dist == INF) ? -1 : adj[k].dist;
+    }
+
+    auto fresh = std::make_shared<MonitorAlerts>();
+    fresh->monitor_count = monitors.size();
+    long long now = now_epoch();
+    for (size_t i = 0; i < monitors.size(); ++i) {
+        const Monitor& m = monitors[i];
+        long long eta_b = eta_base_[i], eta_a = eta_adj[i];
+        if (eta_b < 0 || eta_a < 0) continue;
+        long long delta = eta_a - eta_b;
+        if (delta < m.threshold_minutes) continue;
+        fresh->alerts.push_back({
+            {"monitor_id", m.id},
+            {"src", m.src},
+            {"dst", m.dst},
+            {"eta_base", eta_b},
+            {"eta_adj", eta_a},
+            {"delta", delta},
+            {"timestamp", now}
+            });
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    fresh->generation = alerts_->generation + 1;
+    alerts_ = std::move(fresh);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "json.hpp"
+#include "dijkstra.hpp"
+#include "journal.hpp"
+#include "penalty.hpp"
+#include "store.hpp"
+
+struct Monitor {
+    int id;
+    int src;
+    int dst;
+    int threshold_minutes; // alert when adjusted ETA - baseline ETA >= threshold
+    long long created_at;
+};
+
+// Result of one evaluation pass, shared read-only by every SSE connection.
+struct MonitorAlerts {
+    nlohmann::json alerts = nlohmann::json::array(); // {monitor_id, src, dst, eta_base, eta_adj, delta, timestamp}
+    size_t monitor_count = 0;
+    unsigned long long generation = 0;               // bumped by every published pass
+};
+
+// Owns the registered monitors and evaluates all of them on one background thread,
+// once per change of the monitor set or of the penalty overlay (incident added,
+// cleared or expired). Monitors are grouped by src, so one early-exit search per
+// metric serves every dst of that source.
+class MonitorEngine {
+public:
+    explicit MonitorEngine(PenaltyCache& penalties) : penalties_(penalties) {}
+
+    // Spawns the evaluation thread; `on_publish` runs after each new MonitorAlerts is visible.
+    void start(const Graph& g, Store& store, std::function<void()> on_publish);
+
+    // Registers a monitor (id and created_at are assigned here) and returns its id.
+    int add(Monitor m);
+    std::vector<Monitor> list();
+
+    // Ask for an evaluation now (every change of monitors or incidents does).
+    void poke();
+
+    // Persistence: add() journals a MonitorPut and returns once it is durable.
+    void attach_journal(Journal* journal);
+    void replay(Journal::Decoder& d);
+    void capture(const Journal::PutFn& put);
+
+    std::shared_ptr<const MonitorAlerts> alerts();
+
+private:
+    void run();
+    void evaluate(const std::vector<Monitor>& monitors, const PenaltyOverlay& overlay, bool monitors_changed);
+
+    PenaltyCache& penalties_;
+    const Graph* graph_ = nullptr;
+    Store* store_ = nullptr;
+    std::function<void()> on_publish_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool poked_ = true;     // first pass runs right away
+    std::vector<Monitor> monitors_;
+    int next_id_ = 1;
+    unsigned long long monitors_version_ = 0;
+    std::shared_ptr<const MonitorAlerts> alerts_ = std::make_shared<MonitorAlerts>();
+    Journal* journal_ = nullptr;
+
+    // evaluation thread only
+    std::vector<long long> eta_base_;  // per monitor, -1 = unreachable; valid for the last monitor set
+};
@@ -0,0 +1,105 @@
+#include "penalty.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+double severity_multiplier(int severity) {
+    return (severity <= 1) ? 1.5 : (severity == 2 ? 2.2 : 3.0);
+}
+
+long long severity_additive_penalty(int severity) {
+    return (severity <= 1) ? 2 : (severity == 2 ? 5 : 10);
+}
+
+// Stacked incidents compound; cap the weight so path sums cannot overflow.
+static const long long kMaxPenalizedWeight = 1LL << 40;
+
+static long long apply_penalty(long long w, int severity, PenaltyKind kind) {
+    if (kind == PenaltyKind::Additive) return std::min(w + severity_additive_penalty(severity), kMaxPenalizedWeight);
+    return static_cast<long long>(std::min(std::ceil(w * severity_multiplier(severity)), (double)kMaxPenalizedWeight));
+}
+
+PenaltyOverlay build_penalty_overlay(const Graph& g, const IncidentList& incidents, PenaltyKind kind) {
+    PenaltyOverlay out;
+    out.w.resize(g.edges.size());
+    for (size_t i = 0; i < g.edges.size(); ++i) out.w[i] = g.edges[i].w;
+
+    // each incident touches only its node's out- and in-edges: O(deg) via the reverse index
+    for (const auto& inc : incidents) {
+        int node = inc.node_or_edge;
+        if (node < 0 || node >= g.n) continue;
+        for (int i = g.offsets[node]; i < g.offsets[node + 1]; ++i)
+            out.w[i] = apply_penalty(out.w[i], inc.severity, kind);
+        for (const auto& ie : g.in(node))
+            out.w[ie.id] = apply_penalty(out.w[ie.id], inc.severity, kind);
+    }
+    return out;
+}
+
+void PenaltyCache::attach(const CustomizableCH* cch) {
+    cch_ = cch;
+}
+
+std::shared_ptr<const PenaltyOverlay> PenaltyCache::build(const IncidentSnapshot& snap) const {
+    auto fresh = std::make_shared<PenaltyOverlay>(build_penalty_overlay(*graph_, snap.incidents, kind_));
+    fresh->version = snap.version;
+    if (cch_ && cch_->node_count() == graph_->n && cch_->edge_count() == graph_->edge_count())
+        fresh->cch = std::make_shared<UpwardGraph>(cch_->customize(fresh->w));
+    return fresh;
+}
+
+void PenaltyCache::start(const Graph& g, Store& store, std::function<void()> on_rebuilt) {
+    graph_ = &g;
+    store_ = &store;
+    on_rebuilt_ = std::move(on_rebuilt);
+    std::atomic_store(&overlay_, build(*store.snapshot()));
+    store.on_change([this]() {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            dirty_ = true;
+        }
+        dirty_cv_.notify_one();
+        });
+    std::thread([this]() { run(); }).detach();
+}
+
+std::shared_ptr<const PenaltyOverlay> PenaltyCache::current() const {
+    return std::atomic_load(&overlay_);
+}
+
+bool PenaltyCache::wait(unsigned long long version, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    bool built = false;
+    built_cv_.wait_for(lk, timeout, [&] {
+        auto o = current();
+        built = o && o->version >= version;
+        return built || failed_version_ >= version;
+        });
+    return built;
+}
+
+void PenaltyCache::run() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+        dirty_cv_.wait(lk, [this] { return dirty_; });
+        dirty_ = false; // changes arriving during the build set it again
+        lk.unlock();
+        auto snap = store_->snapshot();
+        bool rebuilt = false, failed = false;
+        try {
+            if (current()->version != snap->version) {
+                std::atomic_store(&overlay_, build(*snap));
+                rebuilt = true;
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[penalty] rebuild failed: " << e.what() << "\n";
+            failed = true;
+        }
+        if (rebuilt && on_rebuilt_) on_rebuilt_();
+        lk.lock();
+        if (failed) failed_version_ = snap->version; // waiters on it give up instead of hanging
+        if (rebuilt || failed) built_cv_.notify_all();
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "dijkstra.hpp"
+#include "cch.hpp"
+#include "store.hpp"
+
+// How an incident at a node changes the cost of the edges touching it.
+enum class PenaltyKind {
+    Multiplier, // /route and /predict: w * 1.5 / 2.2 / 3.0 (rounded up)
+    Additive    // monitors: w + 2 / 5 / 10 minutes
+};
+
+// Adjusted weights for every edge of a base graph, derived from one incident set.
+struct PenaltyOverlay {
+    EdgeWeights w;                      // indexed like Graph::edges
+    unsigned long long version = 0;     // Store::incidents_version() it was built from
+    std::shared_ptr<const UpwardGraph> cch; // `w` customized into the attached CCH, if any
+};
+
+double severity_multiplier(int severity);
+long long severity_additive_penalty(int severity);
+
+// Penalizes both the outgoing and incoming edges of every incident node.
+PenaltyOverlay build_penalty_overlay(const Graph& g, const IncidentList& incidents, PenaltyKind kind);
+
+// Keeps one overlay per kind, rebuilt eagerly on its own thread whenever the store
+// publishes a new incident set (a lapsing incident is purged, which is a change), so
+// the overlay build and CCH customization never run on a request. Readers only load
+// the latest published overlay; right after a change it may still be the previous one.
+class PenaltyCache {
+public:
+    explicit PenaltyCache(PenaltyKind kind) : kind_(kind) {}
+
+    // Every overlay is also customized into `cch` (built from the same graph). Call
+    // before start().
+    void attach(const CustomizableCH* cch);
+
+    // Builds the first overlay, then spawns the rebuild thread; `on_rebuilt` runs on it
+    // after each newly published overlay.
+    void start(const Graph& g, Store& store, std::function<void()> on_rebuilt = nullptr);
+
+    // Latest overlay; lock-free (atomic shared_ptr load). Null before start().
+    std::shared_ptr<const PenaltyOverlay> current() const;
+
+    // Blocks until current() reflects at least incidents version `version`, for writers
+    // that want their own change visible to their next read. False if the rebuild for
+    // that version failed or did not finish within `timeout`; current() then still
+    // holds an older overlay, and the next store change retries.
+    bool wait(unsigned long long version, std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+private:
+    void run();
+    std::shared_ptr<const PenaltyOverlay> build(const IncidentSnapshot& snap) const;
+
+    PenaltyKind kind_;
+    const CustomizableCH* cch_ = nullptr;
+    const Graph* graph_ = nullptr;
+    Store* store_ = nullptr;
+    std::function<void()> on_rebuilt_;
+
+    std::mutex mutex_;
+    std::condition_variable dirty_cv_;               // rebuild thread: the store changed
+    std::condition_variable built_cv_;               // wait(): a new overlay was published
+    bool dirty_ = false;
+    unsigned long long failed_version_ = 0;          // newest snapshot whose rebuild threw
+    std::shared_ptr<const PenaltyOverlay> overlay_;  // std::atomic_load / atomic_store only
+};
@@ -0,0 +1,216 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Priority queues for the Dijkstra engine. They share one interface:
+//   reset(n)        prepare for node ids [0, n)
+//   push(v, key)    insert v, or lower its key
+//   empty()
+//   pop()           -> {key, v}
+// Lazy queues (binary, Dial, radix) keep superseded entries and may pop them;
+// the engine skips those by comparing the key with dist[v]. Popped keys never
+// decrease, which holds for Dijkstra with non-negative weights.
+
+// std::priority_queue with lazy deletion (the original engine).
+class BinaryHeapQueue {
+public:
+    void reset(int) { pq_ = {}; }
+    void push(int v, long long key) { pq_.push({ key, v }); }
+    bool empty() const { return pq_.empty(); }
+    std::pair<long long, int> pop() { auto top = pq_.top(); pq_.pop(); return top; }
+
+private:
+    using pli = std::pair<long long, int>;
+    std::priority_queue<pli, std::vector<pli>, std::greater<pli>> pq_;
+};
+
+inline int bit_length(unsigned long long x) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    return _BitScanReverse64(&idx, x) ? (int)idx + 1 : 0;
+#else
+    return x ? 64 - __builtin_clzll(x) : 0;
+#endif
+}
+
+// Radix heap for monotone integer keys: bucket i holds keys whose highest bit
+// differing from the last popped key is bit i-1.
+class RadixHeapQueue {
+public:
+    void reset(int) {
+        for (auto& bucket : buckets_) bucket.clear();
+        size_ = 0;
+        last_ = 0;
+    }
+    void push(int v, long long key) {
+        buckets_[bit_length((unsigned long long)(key ^ last_))].push_back({ key, v });
+        ++size_;
+    }
+    bool empty() const { return size_ == 0; }
+    std::pair<long long, int> pop() {
+        if (buckets_[0].empty()) {
+            int i = 1;
+            while (buckets_[i].empty()) ++i;
+            long long low = buckets_[i].front().first;
+            for (const auto& item : buckets_[i]) low = std::min(low, item.first);
+            last_ = low;
+            for (const auto& item : buckets_[i])
+                buckets_[bit_length((unsigned long long)(item.first ^ last_))].push_back(item);
+            buckets_[i].clear();
+        }
+        auto top = buckets_[0].back();
+        buckets_[0].pop_back();
+        --size_;
+        return top;
+    }
+
+private:
+    std::vector<std::pair<long long, int>> buckets_[65];
+    size_t size_ = 0;
+    long long last_ = 0;
+};
+
+// Dial's bucket queue: a circular array of buckets, one per key. Sized from the
+// graph's max edge weight and grown if a key lands beyond the window, up to
+// kMaxBuckets; a key beyond that (e.g. a heavily penalized edge) moves the whole
+// queue into a radix heap until the next reset().
+class DialQueue {
+public:
+    static constexpr long long kMaxBuckets = 1 << 16;
+
+    // Throws std::length_error for max_weight >= kMaxBuckets: use a radix heap there.
+    explicit DialQueue(long long max_weight = 63) {
+        if (max_weight >= kMaxBuckets) throw std::length_error("DialQueue: max_weight too large for a bucket window");
+        size_t b = 1;
+        while ((long long)b <= max_weight) b <<= 1;
+        buckets_.resize(b);
+    }
+    void reset(int n) {
+        for (auto& bucket : buckets_) bucket.clear();
+        size_ = 0;
+        cursor_ = 0;
+        spilled_ = false;
+        spill_.reset(n);
+    }
+    void push(int v, long long key) {
+        if (!spilled_ && key - cursor_ >= (long long)buckets_.size()) {
+            if (key - cursor_ < kMaxBuckets) grow(key - cursor_ + 1);
+            else spill();
+        }
+        if (spilled_) { spill_.push(v, key); return; }
+        buckets_[key & (long long)(buckets_.size() - 1)].push_back({ key, v });
+        ++size_;
+    }
+    bool empty() const { return spilled_ ? spill_.empty() : size_ == 0; }
+    std::pair<long long, int> pop() {
+        if (spilled_) return spill_.pop();
+        long long mask = (long long)(buckets_.size() - 1);
+        while (buckets_[cursor_ & mask].empty()) ++cursor_;
+        auto& bucket = buckets_[cursor_ & mask];
+        auto top = bucket.back();
+        bucket.pop_back();
+        --size_;
+        return top;
+    }
+
+private:
+    std::vector<std::vector<std::pair<long long, int>>> buckets_;
+    size_t size_ = 0;
+    long long cursor_ = 0;
+    bool spilled_ = false;
+    RadixHeapQueue spill_;
+
+    // every pending key is >= cursor_ >= the radix heap's last popped key (0)
+    void spill() {
+        for (auto& bucket : buckets_) {
+            for (const auto& item : bucket) spill_.push(item.second, item.first);
+            bucket.clear();
+        }
+        size_ = 0;
+        spilled_ = true;
+    }
+
+    void grow(long long span) {
+        size_t b = buckets_.size();
+        while ((long long)b < span) b <<= 1;
+        std::vector<std::vector<std::pair<long long, int>>> next(b);
+        for (auto& bucket : buckets_)
+            for (const auto& item : bucket) next[item.first & (long long)(b - 1)].push_back(item);
+        buckets_.swap(next);
+    }
+};
+
+// Indexed D-ary heap with decrease-key: one entry per node, never stale.
+template <int D = 4>
+class DaryHeapQueue {
+public:
+    void reset(int n) {
+        heap_.clear();
+        pos_.assign(n, -1);
+        key_.resize(n);
+    }
+    void push(int v, long long key) {
+        if (pos_[v] < 0) {
+            key_[v] = key;
+            pos_[v] = (int)heap_.size();
+            heap_.push_back(v);
+            sift_up(pos_[v]);
+        }
+        else if (key < key_[v]) {
+            key_[v] = key;
+            sift_up(pos_[v]);
+        }
+    }
+    bool empty() const { return heap_.empty(); }
+    std::pair<long long, int> pop() {
+        int top = heap_[0];
+        pos_[top] = -1;
+        int last = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) {
+            heap_[0] = last;
+            pos_[last] = 0;
+            sift_down(0);
+        }
+        return { key_[top], top };
+    }
+
+private:
+    std::vector<int> heap_;
+    std::vector<int> pos_;
+    std::vector<long long> key_;
+
+    void place(int i, int v) { heap_[i] = v; pos_[v] = i; }
+    void sift_up(int i) {
+        int v = heap_[i];
+        while (i > 0) {
+            int parent = (i - 1) / D;
+            if (key_[heap_[parent]] <= key_[v]) break;
+            place(i, heap_[parent]);
+            i = parent;
+        }
+        place(i, v);
+    }
+    void sift_down(int i) {
+        int v = heap_[i];
+        int n = (int)heap_.size();
+        while (true) {
+            int first = i * D + 1;
+            if (first >= n) break;
+            int best = first;
+            for (int c = first + 1; c < first + D && c < n; ++c)
+                if (key_[heap_[c]] < key_[heap_[best]]) best = c;
+            if (key_[heap_[best]] >= key_[v]) break;
+            place(i, heap_[best]);
+            i = best;
+        }
+        place(i, v);
+    }
+};
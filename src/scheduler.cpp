@@ -0,0 +1,101 @@
+#include "scheduler.hpp"
+#include <algorithm>
+#include <iostream>
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+Scheduler::JobId Scheduler::at(Clock::time_point due, std::function<void()> fn) {
+    return add(due, Clock::duration(0), std::move(fn));
+}
+
+Scheduler::JobId Scheduler::every(Clock::duration period, std::function<void()> fn) {
+    if (period <= Clock::duration(0)) period = std::chrono::milliseconds(1);
+    return add(Clock::now() + period, period, std::move(fn));
+}
+
+Scheduler::JobId Scheduler::add(Clock::time_point due, Clock::duration period, std::function<void()> fn) {
+    JobId id;
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        id = next_id_++;
+        jobs_[id] = Job{ due, period, std::move(fn) };
+        earliest = heap_.empty() || due < heap_.top().first;
+        heap_.push({ due, id });
+        if (!thread_.joinable()) thread_ = std::thread([this]() { run(); });
+    }
+    if (earliest) cv_.notify_one(); // the timer thread sleeps until the old top
+    return id;
+}
+
+bool Scheduler::cancel(JobId id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (jobs_.erase(id) == 0) return false;
+    ++stats_.cancelled;
+    return true; // its heap entry is skipped when it surfaces
+}
+
+Scheduler::Stats Scheduler::stats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    Stats s = stats_;
+    s.queued = jobs_.size();
+    s.avg_lateness_us = s.executed ? lateness_total_us_ / (long long)s.executed : 0;
+    return s;
+}
+
+void Scheduler::run() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (!stopping_) {
+        if (heap_.empty()) {
+            cv_.wait(lk);
+            continue;
+        }
+        Entry top = heap_.top();
+        auto it = jobs_.find(top.second);
+        if (it == jobs_.end() || it->second.due != top.first) { // cancelled
+            heap_.pop();
+            continue;
+        }
+        auto now = Clock::now();
+        if (now < top.first) {
+            cv_.wait_until(lk, top.first);
+            continue; // woken early by an earlier job, or re-check the top
+        }
+        heap_.pop();
+
+        long long late = std::chrono::duration_cast<std::chrono::microseconds>(now - top.first).count();
+        ++stats_.executed;
+        stats_.last_lateness_us = late;
+        stats_.max_lateness_us = std::max(stats_.max_lateness_us, late);
+        lateness_total_us_ += late;
+
+        std::function<void()> fn;
+        if (it->second.period > Clock::duration(0)) {
+            Job& job = it->second;
+            job.due += job.period;
+            if (job.due <= now) job.due = now + job.period; // no catch-up bursts
+            heap_.push({ job.due, top.second });
+            fn = job.fn; // the job stays registered while it runs
+        }
+        else {
+            fn = std::move(it->second.fn);
+            jobs_.erase(it);
+        }
+
+        lk.unlock();
+        try {
+            fn();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[scheduler] job " << top.second << " threw: " << e.what() << "\n";
+        }
+        lk.lock();
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// One timer thread for all deferred work (delayed /simulate injections, incident
+// expiry, recurring jobs) instead of a sleeping thread per job. Jobs sit in a min-heap
+// on their due time and run on the timer thread in due order, so they must be short;
+// a job that blocks delays everything behind it (visible as lateness in stats()).
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using JobId = unsigned long long; // never 0
+
+    struct Stats {
+        size_t queued = 0;                  // jobs waiting (recurring ones count once)
+        unsigned long long executed = 0;
+        unsigned long long cancelled = 0;
+        long long last_lateness_us = 0;     // start time minus due time of the last run
+        long long max_lateness_us = 0;
+        long long avg_lateness_us = 0;
+    };
+
+    Scheduler() = default;
+    ~Scheduler(); // drops pending jobs, waits for a running one
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // The timer thread starts with the first scheduled job.
+    JobId at(Clock::time_point due, std::function<void()> fn);
+    JobId after(Clock::duration delay, std::function<void()> fn) { return at(Clock::now() + delay, std::move(fn)); }
+    // Runs fn every `period` (first run one period from now) until cancelled; a late run
+    // does not cause a burst of catch-up runs.
+    JobId every(Clock::duration period, std::function<void()> fn);
+
+    // True if the job was still pending; a job already running is not interrupted.
+    bool cancel(JobId id);
+
+    Stats stats();
+
+private:
+    struct Job {
+        Clock::time_point due;
+        Clock::duration period{ 0 };   // 0 = one-shot
+        std::function<void()> fn;
+    };
+    using Entry = std::pair<Clock::time_point, JobId>;
+
+    JobId add(Clock::time_point due, Clock::duration period, std::function<void()> fn);
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    // min-heap on due time; entries whose job was cancelled or rescheduled are skipped
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+    std::unordered_map<JobId, Job> jobs_;
+    JobId next_id_ = 1;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    Stats stats_;
+    long long lateness_total_us_ = 0;
+};
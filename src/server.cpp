@@ -1,4 +1,18 @@
 ﻿    #include "server.hpp"
+    #include "penalty.hpp"
+    #include "ch.hpp"
+    #include "cch.hpp"
+    #include "matrix.hpp"
+    #include "monitor_engine.hpp"
+    #include "broadcaster.hpp"
+    #include "sse_server.hpp"
+    #include "change_notifier.hpp"
+    #include "journal.hpp"
+    #include "scheduler.hpp"
+    #include "worker_pool.hpp"
+    #include <algorithm>
+    #include <cctype>
+    #include <cstdlib>
     #include <iostream>
     #include <thread>
     #include <chrono>
@@ -7,6 +21,7 @@
     #include <atomic>
     #include<mutex> //for th
     #include<vector>
+    #include <map>
 
 // ---------------- Calendar (in-memory, simple .ics parser) ----------------
 struct CalendarEvent {
@@ -14,21 +29,9 @@ struct CalendarEvent {
     std::string summary;
 };
 
-// monitor struct
-struct Monitor {
-    int id;
-    int src;
-    int dst;
-    int threshold_minutes; // alert when adjusted ETA - baseline ETA >= threshold
-    long long created_at;
-};
-static std::mutex g_monitors_mutex;
-static std::vector<Monitor> g_monitors;
-static int g_next_monitor_id = 1;
     
-    static std::mutex g_events_mutex;
-    static std::condition_variable g_events_cv;
-    static std::atomic<bool> g_events_flag{ false };
+    // bumped on every change /events reports; GUARDIAN_EVENTS_DEBOUNCE_MS sets the window
+    static ChangeNotifier g_state_changes;
     
     //For da Calenders 
     static std::mutex g_calendar_mutex;
@@ -85,7 +88,7 @@ Store STORE;
 // Build demo graph (-node layout)
 Graph build_demo_graph() {
     // create 10 nodes (0..9)
-    Graph g(10);
+    GraphBuilder g(10);
 
     // helper for bidirectional edges
     auto add_bi = [&](int a, int b, long long w) {
@@ -110,64 +113,557 @@ Graph build_demo_graph() {
     // add_bi(2, 6, 6);   // mid diagonal connector
     // add_bi(1, 7, 6);   // alternate cross connector
 
-    g.n = 10;
-    return g;
+    return g.build();
 }
 
-// made it global might need it late for other purposes
-nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
-    Graph baseline = GRAPH;
-    Graph adjusted = GRAPH;
+// incident-adjusted weights, rebuilt only when the incident set changes
+static PenaltyCache g_route_penalties(PenaltyKind::Multiplier);
+static PenaltyCache g_monitor_penalties(PenaltyKind::Additive);
+
+// evaluates every monitor once per incident change; SSE connections only read its alerts
+static MonitorEngine g_monitor_engine(g_monitor_penalties);
+
+static const size_t kMaxBulkIncidents = 10000;
+
+// One /incidents/bulk record: {"node", "severity"?, "desc"?, "duration_s"?}; duration_s 0
+// (the default) never expires, like /report.
+static Incident bulk_incident(const nlohmann::json& r, int node_count, size_t index) {
+    auto fail = [index](const std::string& why) {
+        return std::runtime_error("record " + std::to_string(index) + ": " + why);
+    };
+    if (!r.is_object()) throw fail("expected an object");
+    auto node = r.find("node");
+    if (node == r.end() || !node->is_number_integer()) throw fail("node must be an integer");
+    Incident inc;
+    inc.node_or_edge = node->get<int>();
+    if (inc.node_or_edge < 0 || inc.node_or_edge >= node_count) throw fail("node out of range");
+    inc.severity = r.value("severity", 1);
+    if (inc.severity < 1 || inc.severity > 3) throw fail("severity must be 1..3");
+    inc.description = r.value("desc", std::string("bulk incident"));
+    long long duration_s = r.value("duration_s", 0LL);
+    if (duration_s < 0) throw fail("duration_s must be >= 0");
+    if (duration_s > 0) {
+        inc.timestamp = (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        inc.expires_at = inc.timestamp + duration_s;
+    }
+    return inc;
+}
+
+// Accepts a JSON array or NDJSON (one object per line). Records are converted as the
+// parser completes them, so the body is never held as one JSON tree; any invalid
+// record rejects the whole batch.
+static std::vector<Incident> parse_bulk_incidents(const std::string& body, int node_count) {
+    std::vector<Incident> out;
+    auto add = [&](const nlohmann::json& r) {
+        if (out.size() == kMaxBulkIncidents)
+            throw std::runtime_error("at most " + std::to_string(kMaxBulkIncidents) + " incidents per batch");
+        out.push_back(bulk_incident(r, node_count, out.size()));
+    };
+    size_t start = body.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return out;
+    if (body[start] == '[') {
+        using Event = nlohmann::json::parse_event_t;
+        nlohmann::json rest = nlohmann::json::parse(body, [&](int depth, Event event, nlohmann::json& parsed) {
+            if (depth != 1 || (event != Event::object_end && event != Event::array_end && event != Event::value))
+                return true;
+            add(parsed);
+            return false; // converted; keep it out of `rest`
+            });
+        (void)rest;
+        return out;
+    }
+    const char* p = body.data();
+    const char* end = p + body.size();
+    while (p < end) {
+        const char* eol = std::find(p, end, '\n');
+        if (std::find_if(p, eol, [](char c) { return !std::isspace((unsigned char)c); }) != eol)
+            add(nlohmann::json::parse(p, eol));
+        p = eol == end ? end : eol + 1;
+    }
+    return out;
+}
+
+// runs what scheduler jobs hand off because it blocks (a /simulate injection waits for
+// the journal's fsync); one thread keeps injections in due order. Declared before the
+// scheduler so it outlives the jobs that feed it.
+static WorkerPool g_deferred_writes(1);
 
-    auto incidents = STORE.get_incidents_copy();
+// timer thread for all deferred work: /simulate injections, incident expiry
+static Scheduler g_scheduler;
 
-    for (const auto& inc : incidents) {
-        int node = inc.node_or_edge;
-        double multiplier = (inc.severity <= 1) ? 1.5 : (inc.severity == 2 ? 2.2 : 3.0);
+// pending /simulate injections: simulation id -> scheduler job (removed when it runs)
+static std::mutex g_simulations_mutex;
+static std::map<int, Scheduler::JobId> g_simulations;
+static int g_next_simulation = 1;
 
-        if (node >= 0 && node < adjusted.n) {
-            for (auto& e : adjusted.adj[node])
-                e.w = static_cast<long long>(std::ceil(e.w * multiplier));
+// write-ahead log + snapshots under GUARDIAN_DATA_DIR; opened in run_server before any request
+static Journal g_journal;
 
-            for (int u = 0; u < adjusted.n; ++u)
-                for (auto& e : adjusted.adj[u])
-                    if (e.to == node)
-                        e.w = static_cast<long long>(std::ceil(e.w * multiplier));
+// expects g_calendar_mutex to be held; the whole calendar is one record
+static Journal::Encoder encode_calendar() {
+    Journal::Encoder e;
+    e.i32((int32_t)g_calendar_events.size());
+    for (const auto& ev : g_calendar_events) e.i64(ev.start_epoch).str(ev.summary);
+    return e;
+}
+
+static Journal::Encoder encode_persona(const std::string& name, const nlohmann::json& body) {
+    Journal::Encoder e;
+    e.str(name).str(body.dump());
+    return e;
+}
+
+static void journal_apply(Journal::Type type, Journal::Decoder& d) {
+    if (STORE.replay(type, d)) return;
+    switch (type) {
+    case Journal::Type::MonitorPut:
+        g_monitor_engine.replay(d);
+        break;
+    case Journal::Type::PersonaPut: {
+        std::string name = d.str();
+        std::string body = d.str();
+        if (!d.ok()) break;
+        std::lock_guard<std::mutex> lg(g_personas_mutex);
+        g_personas[name] = nlohmann::json::parse(body, nullptr, false);
+        break;
+    }
+    case Journal::Type::CalendarSet: {
+        std::vector<CalendarEvent> events(std::max(0, d.i32()));
+        for (auto& ev : events) {
+            ev.start_epoch = d.i64();
+            ev.summary = d.str();
         }
+        if (!d.ok()) break;
+        std::lock_guard<std::mutex> lg(g_calendar_mutex);
+        g_calendar_events = std::move(events);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void journal_capture(const Journal::PutFn& put) {
+    STORE.capture(put);
+    g_monitor_engine.capture(put);
+    {
+        std::lock_guard<std::mutex> lg(g_personas_mutex);
+        for (const auto& p : g_personas) put(Journal::Type::PersonaPut, encode_persona(p.first, p.second));
+    }
+    std::lock_guard<std::mutex> lg(g_calendar_mutex);
+    put(Journal::Type::CalendarSet, encode_calendar());
+}
+
+// GUARDIAN_DATA_DIR (default ./guardian_data, empty = in-memory only) and
+// GUARDIAN_WAL_COMPACT_MB (log size that triggers a snapshot, default 64)
+static void open_journal() {
+    std::string dir = "guardian_data";
+    if (const char* env = std::getenv("GUARDIAN_DATA_DIR")) dir = env;
+    if (dir.empty()) return;
+    size_t compact_mb = 64;
+    if (const char* env = std::getenv("GUARDIAN_WAL_COMPACT_MB")) compact_mb = (size_t)std::max(1, std::atoi(env));
+    auto t0 = std::chrono::steady_clock::now();
+    if (!g_journal.open(dir, journal_apply, journal_capture, compact_mb << 20)) {
+        std::cerr << "[journal] persistence disabled\n";
+        return;
+    }
+    STORE.attach_journal(&g_journal);
+    g_monitor_engine.attach_journal(&g_journal);
+    STORE.finish_replay();
+    std::cout << "[journal] recovered " << g_journal.recovered() << " records from " << dir << " in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count() << " ms\n";
+}
+
+// baseline hierarchy, prepared once in run_server before the first request
+static ContractionHierarchy g_baseline_ch;
+
+// Loads the hierarchy from $GUARDIAN_CH_PATH when it matches the graph,
+// otherwise contracts the graph now (and saves it there if a path is set).
+static void prepare_baseline_ch(const Graph& g) {
+    const char* path = std::getenv("GUARDIAN_CH_PATH");
+    if (path && ContractionHierarchy::load(path, g, g_baseline_ch)) {
+        std::cout << "[ch] loaded hierarchy from " << path << "\n";
+        return;
     }
+    auto t0 = std::chrono::steady_clock::now();
+    g_baseline_ch = ContractionHierarchy::build(g);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[ch] contracted " << g.n << " nodes in " << ms << " ms (" << g_baseline_ch.shortcut_count() << " shortcuts)\n";
+    if (path && !g_baseline_ch.save(path)) std::cerr << "[ch] could not save hierarchy to " << path << "\n";
+}
+
+// incident metrics are customized into this topology on every incident change
+static CustomizableCH g_cch;
+
+static void prepare_cch(const Graph& g) {
+    auto t0 = std::chrono::steady_clock::now();
+    g_cch = CustomizableCH::build(g);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[cch] " << g_cch.arc_count() << " arcs prepared in " << ms << " ms\n";
+    g_route_penalties.attach(&g_cch);
+}
+
+// For writers answering only once /route sees their change. If the overlay rebuild
+// failed or stalled, answers 503 (the change itself is stored) and returns false.
+static bool await_route_overlay(unsigned long long version, httplib::Response& res) {
+    if (g_route_penalties.wait(version)) return true;
+    res.status = 503;
+    res.set_content(nlohmann::json({ {"error", "change stored, but the route overlay was not rebuilt"} }).dump(), "application/json");
+    return false;
+}
+
+// made it global might need it late for other purposes
+nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
+    auto overlay = g_route_penalties.current();
 
-    auto res_base = dijkstra(baseline, src);
-    auto path_base = recover_path(res_base, src, dst);
-    long long eta_base = (res_base.dist[dst] == INF) ? -1 : res_base.dist[dst];
+    // both searches reuse this thread's DijkstraWorkspace, so nothing here is O(n)
+    RouteResult res_base = (g_baseline_ch.node_count() == GRAPH.n)
+        ? g_baseline_ch.route(src, dst)
+        : route_p2p(GRAPH, src, dst);
+    long long eta_base = (res_base.dist == INF) ? -1 : res_base.dist;
 
-    auto res_adj = dijkstra(adjusted, src);
-    auto path_adj = recover_path(res_adj, src, dst);
-    long long eta_adj = (res_adj.dist[dst] == INF) ? -1 : res_adj.dist[dst];
+    RouteResult res_adj = overlay->cch
+        ? upward_route(*overlay->cch, src, dst)
+        : route_p2p(GRAPH, src, dst, overlay->w);
+    long long eta_adj = (res_adj.dist == INF) ? -1 : res_adj.dist;
 
     nlohmann::json r;
-    r["baseline"] = { {"path", path_base}, {"eta_minutes", eta_base} };
-    r["adjusted"] = { {"path", path_adj}, {"eta_minutes", eta_adj} };
+    r["baseline"] = { {"path", res_base.path}, {"eta_minutes", eta_base} };
+    r["adjusted"] = { {"path", res_adj.path}, {"eta_minutes", eta_adj} };
     return r;
 }
 
-    void run_server(int port) {
-        httplib::Server svr;
-        Graph GRAPH = build_demo_graph();
-        // start background cleaner thread: removes expired incidents periodically
-        std::thread([]() {
-            while (true) {
-                std::this_thread::sleep_for(std::chrono::seconds(2));
-                try {
-                    STORE.remove_expired(); // ensure Store::remove_expired is thread-safe
-                    // notify SSE clients that incidents may have changed
-                    g_events_flag.store(true);
-                    g_events_cv.notify_all();
+// Shared by /route/batch and /matrix: one thread per core besides the request thread,
+// started with the server. Each thread uses its own thread_local DijkstraWorkspace, so
+// search state is never shared.
+static WorkerPool g_batch_pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+
+static const size_t kMaxBatchPairs = 10000;
+
+// One entry per input pair, in input order, with the same baseline/adjusted objects as /route.
+// Pairs are grouped by src: a group runs one early-exit search per metric for all of its
+// destinations (a lone destination goes through the hierarchies instead), and groups run in parallel.
+nlohmann::json compute_route_batch(const Graph& GRAPH, const std::vector<std::pair<int, int>>& pairs) {
+    auto overlay = g_route_penalties.current();
+
+    std::map<int, std::vector<size_t>> by_src; // src -> indices into pairs
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        auto [src, dst] = pairs[i];
+        if (src < 0 || src >= GRAPH.n || dst < 0 || dst >= GRAPH.n) continue;
+        by_src[src].push_back(i);
+    }
+    std::vector<std::pair<int, std::vector<size_t>>> groups(by_src.begin(), by_src.end());
+
+    std::vector<RouteResult> base(pairs.size()), adj(pairs.size());
+    g_batch_pool.parallel_for(groups.size(), [&](size_t gi) {
+        int src = groups[gi].first;
+        const auto& idx = groups[gi].second;
+        if (idx.size() == 1) {
+            int dst = pairs[idx[0]].second;
+            base[idx[0]] = (g_baseline_ch.node_count() == GRAPH.n) ? g_baseline_ch.route(src, dst) : route_p2p(GRAPH, src, dst);
+            adj[idx[0]] = overlay->cch ? upward_route(*overlay->cch, src, dst) : route_p2p(GRAPH, src, dst, overlay->w);
+            return;
+        }
+        std::vector<NodeId> dsts;
+        for (size_t i : idx) dsts.push_back(pairs[i].second);
+        auto rb = route_to_targets(GRAPH, src, dsts);
+        auto ra = route_to_targets(GRAPH, src, dsts, overlay->w);
+        for (size_t k = 0; k < idx.size(); ++k) {
+            base[idx[k]] = std::move(rb[k]);
+            adj[idx[k]] = std::move(ra[k]);
+        }
+    });
+
+    nlohmann::json out = nlohmann::json::array();
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        auto [src, dst] = pairs[i];
+        nlohmann::json r;
+        r["src"] = src;
+        r["dst"] = dst;
+        if (src < 0 || src >= GRAPH.n || dst < 0 || dst >= GRAPH.n) {
+            r["error"] = "invalid node";
+            out.push_back(std::move(r));
+            continue;
+        }
+        long long eta_base = (base[i].dist == INF) ? -1 : base[i].dist;
+        long long eta_adj = (adj[i].dist == INF) ? -1 : adj[i].dist;
+        r["baseline"] = { {"path", base[i].path}, {"eta_minutes", eta_base} };
+        r["adjusted"] = { {"path", adj[i].path}, {"eta_minutes", eta_adj} };
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+static const size_t kMaxMatrixSide = 2000;
+static const size_t kMatrixRowsPerChunk = 64;
+
+// State of one streamed /matrix response. Keeps the overlay (and with it the customized
+// CCH) alive until the last row is written, even if incidents change meanwhile.
+struct MatrixJob {
+    std::shared_ptr<const PenaltyOverlay> overlay;   // null for the baseline metric
+    std::unique_ptr<DistanceTable> table;            // null: no hierarchy, rows use route_to_targets
+    std::vector<NodeId> sources, targets;
+    size_t next_row = 0;
+};
+
+// Computes rows [next_row, next_row + count) in parallel and renders them as "v,v,...".
+static std::string matrix_rows(const Graph& GRAPH, MatrixJob& job, size_t count) {
+    size_t cols = job.targets.size();
+    std::vector<long long> block(count * cols, INF);
+    g_batch_pool.parallel_for(count, [&](size_t k) {
+        NodeId src = job.sources[job.next_row + k];
+        long long* row = block.data() + k * cols;
+        if (job.table) {
+            job.table->fill_row(src, row);
+            return;
+        }
+        auto routes = job.overlay ? route_to_targets(GRAPH, src, job.targets, job.overlay->w)
+                                  : route_to_targets(GRAPH, src, job.targets);
+        for (size_t j = 0; j < cols; ++j) row[j] = routes[j].dist;
+    });
+    std::string out;
+    out.reserve(block.size() * 4);
+    for (size_t i = 0; i < block.size(); ++i) {
+        if (job.next_row > 0 || i > 0) out += ',';
+        out += std::to_string(block[i] == INF ? -1 : block[i]);
+    }
+    job.next_row += count;
+    return out;
+}
+
+// DNA part of the /events stream: DNA summary plus DNA alerts (while monitors exist).
+static nlohmann::json build_dna_payload() {
+    nlohmann::json payload;
+
+    // Add DNA summary safely (normalize to { node_stats: { node: { avg_delay, count } } })
+    try {
+        auto dna_json_str = DNA.exportSummaryJSON(); // must be thread-safe
+        nlohmann::json dna_out = nlohmann::json::object();
+
+        if (dna_json_str.empty() || dna_json_str == "null") {
+            dna_out["node_stats"] = nlohmann::json::object();
+        }
+        else {
+            auto parsed = nlohmann::json::parse(dna_json_str);
+            // If parsed is an array of {node, severity, avg_delay, samples}
+            if (parsed.is_array()) {
+                nlohmann::json node_stats = nlohmann::json::object();
+                for (auto& item : parsed) {
+                    try {
+                        int node = item.value("node", -1);
+                        double avg = item.value("avg_delay", 0.0);
+                        int samples = item.value("samples", 0);
+                        if (node < 0) continue;
+                        std::string key = std::to_string(node);
+
+                        // ensure object exists
+                        if (!node_stats.contains(key) || !node_stats[key].is_object()) {
+                            node_stats[key] = nlohmann::json::object();
+                            node_stats[key]["avg_delay"] = 0.0;
+                            node_stats[key]["count"] = 0;
+                        }
+
+                        double prev_avg = node_stats[key].value("avg_delay", 0.0);
+                        int prev_count = node_stats[key].value("count", 0);
+
+                        // aggregate: keep the maximum average delay seen across severities,
+                        // and sum samples as a simple count.
+                        double new_avg = std::max(prev_avg, avg);
+                        int new_count = prev_count + samples;
+
+                        node_stats[key]["avg_delay"] = new_avg;
+                        node_stats[key]["count"] = new_count;
+                    }
+                    catch (...) { /* ignore bad items */ }
                 }
-                catch (const std::exception& e) {
-                    std::cerr << "[cleaner] exception: " << e.what() << "\n";
+                dna_out["node_stats"] = node_stats;
+            }
+            // If parsed is an object and already contains node_stats, use it directly
+            else if (parsed.is_object() && parsed.contains("node_stats")) {
+                // normalize to our preferred shape (ensure node entries are objects)
+                nlohmann::json node_stats = nlohmann::json::object();
+                for (auto it = parsed["node_stats"].begin(); it != parsed["node_stats"].end(); ++it) {
+                    const std::string key = it.key();
+                    auto val = it.value();
+                    if (val.is_object()) {
+                        double avg = val.value("avg_delay", 0.0);
+                        int cnt = val.value("count", 0);
+                        node_stats[key] = nlohmann::json::object();
+                        node_stats[key]["avg_delay"] = avg;
+                        node_stats[key]["count"] = cnt;
+                    }
+                    else {
+                        // if value isn't object, skip or set defaults
+                        node_stats[key] = nlohmann::json::object();
+                        node_stats[key]["avg_delay"] = 0.0;
+                        node_stats[key]["count"] = 0;
+                    }
+                }
+                dna_out["node_stats"] = node_stats;
+            }
+            // otherwise return the parsed object under "raw" and provide empty node_stats
+            else {
+                dna_out["raw"] = parsed;
+                dna_out["node_stats"] = nlohmann::json::object();
+            }
+        }
+        payload["dna_summary"] = dna_out;
+    }
+    catch (...) {
+        payload["dna_summary"] = nlohmann::json::object();
+    }
+
+    if (g_monitor_engine.alerts()->monitor_count > 0) {
+        // copy dna alerts under lock, then attach (and optionally clear)
+        nlohmann::json dna_copy = nlohmann::json::array();
+        {
+            std::lock_guard<std::mutex> lg(g_dna_alerts_mutex);
+            if (!g_dna_alerts.empty()) {
+                dna_copy = g_dna_alerts;
+                // OPTIONAL: if you want one-shot semantics for this connection, uncomment:
+                // g_dna_alerts.clear();
+            }
+        }
+        payload["dna_alerts"] = dna_copy;
+
+    } // if monitors
+
+    return payload;
+}
+
+static std::string sse_event(const char* name, const nlohmann::json& data) {
+    std::string out;
+    if (name) out += std::string("event: ") + name + "\n";
+    out += "data: " + data.dump() + "\n\n";
+    return out;
+}
+
+static EventTags incident_tags(const Incident& inc) {
+    EventTags tags;
+    tags.topic = EventTags::Incidents;
+    tags.node = inc.node_or_edge;
+    tags.severity = inc.severity;
+    return tags;
+}
+
+// `snapshot` event whose incident list is filtered per subscriber
+static Broadcaster::Keyframe incidents_keyframe(const std::map<int, Incident>& incidents, unsigned long long version) {
+    Broadcaster::Keyframe k;
+    k.head = "event: snapshot\ndata: {\"incidents\":[";
+    for (const auto& kv : incidents) k.items.push_back({ to_json(kv.second).dump(), incident_tags(kv.second) });
+    k.tail = "],\"version\":" + std::to_string(version) + "}\n\n";
+    k.tags.topic = EventTags::Incidents;
+    return k;
+}
+
+// every /events connection shares the frames published here
+static Broadcaster g_events_broadcaster;
+
+// event-loop SSE endpoint (GUARDIAN_SSE_PORT, default port+1, 0 = off); /events on the
+// main port keeps working but parks an httplib worker per client
+static SseServer g_sse_server(g_events_broadcaster);
+
+// Single producer for /events, woken when g_state_changes advances. Incident changes
+// go out as versioned `incident_added` / `incident_expired` events taken from the store's
+// delta log; the broadcaster is reset to a fresh `snapshot` when the log cannot bridge
+// the gap. The DNA status and each monitor alert go out as plain messages whenever they
+// change. The keyframe a new connection starts from is the current snapshot plus the
+// latest DNA status and monitor alerts. Every event is tagged for topic filtering.
+static void run_events_broadcaster() {
+    std::map<int, Incident> incidents;      // as last published
+    unsigned long long incidents_version = 0;
+    bool synced = false;
+    std::string last_dna, last_alerts;
+    Broadcaster::Draft dna_status;                 // latest of each, for the keyframe
+    std::vector<Broadcaster::Draft> alert_events;
+    // the first pass publishes the initial keyframe
+    for (unsigned long long seen = 0;; seen = g_state_changes.wait_change(seen)) {
+        try {
+            std::vector<Broadcaster::Draft> events;
+            std::vector<IncidentDelta> deltas;
+            bool reset = false;
+            if (!synced || !STORE.incident_deltas(incidents_version, deltas)) {
+                incidents.clear();
+                auto snap = STORE.snapshot();
+                incidents_version = snap->version;
+                for (const auto& inc : snap->incidents) incidents[inc.id] = inc;
+                synced = reset = true;
+            }
+            for (const auto& d : deltas) {
+                bool added = d.kind == IncidentDelta::Kind::Added;
+                if (added) incidents[d.incident.id] = d.incident;
+                else incidents.erase(d.incident.id);
+                incidents_version = d.version;
+                events.push_back({ sse_event(added ? "incident_added" : "incident_expired",
+                    { {"version", d.version}, {"incident", to_json(d.incident)} }), incident_tags(d.incident) });
+            }
+
+            std::string dna = build_dna_payload().dump();
+            if (dna != last_dna) {
+                last_dna = dna;
+                dna_status.text = "data: " + dna + "\n\n";
+                dna_status.tags.topic = EventTags::Dna;
+                events.push_back(dna_status);
+            }
+            // one message per alert, so a client only hears about the monitors it follows
+            auto monitor_alerts = g_monitor_engine.alerts();
+            std::string alerts = monitor_alerts->alerts.dump();
+            if (alerts != last_alerts) {
+                last_alerts = alerts;
+                alert_events.clear();
+                for (const auto& a : monitor_alerts->alerts) {
+                    Broadcaster::Draft e;
+                    e.text = sse_event(nullptr, { {"monitor_alerts", nlohmann::json::array({ a })} });
+                    e.tags.topic = EventTags::Monitors;
+                    e.tags.monitor_id = a.value("monitor_id", -1);
+                    alert_events.push_back(e);
+                    events.push_back(e);
                 }
             }
-            }).detach();
+
+            if (events.empty() && !reset) continue;
+            Broadcaster::Keyframe keyframe = incidents_keyframe(incidents, incidents_version);
+            keyframe.events.push_back(dna_status);
+            keyframe.events.insert(keyframe.events.end(), alert_events.begin(), alert_events.end());
+            if (reset) g_events_broadcaster.reset(std::move(keyframe));
+            else g_events_broadcaster.publish(events, std::move(keyframe));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[events] exception: " << e.what() << "\n";
+        }
+    }
+}
+
+    void run_server(int port) {
+        httplib::Server svr;
+        Graph GRAPH = build_demo_graph();
+        prepare_baseline_ch(GRAPH);
+        prepare_cch(GRAPH);
+        open_journal(); // before anything reads or changes the store
+        g_batch_pool.start();
+        if (const char* env = std::getenv("GUARDIAN_EVENTS_DEBOUNCE_MS"))
+            g_state_changes.set_debounce(std::chrono::milliseconds(std::atoi(env)));
+        // overlays are rebuilt off the request path after every incident change
+        g_route_penalties.start(GRAPH, STORE);
+        g_monitor_penalties.start(GRAPH, STORE, []() { g_monitor_engine.poke(); });
+        g_monitor_engine.start(GRAPH, STORE, []() { g_state_changes.bump(); });
+        int sse_port = port + 1;
+        if (const char* env = std::getenv("GUARDIAN_SSE_PORT")) sse_port = std::atoi(env);
+        // slow-consumer policy: GUARDIAN_SSE_QUEUE frames per client, then
+        // GUARDIAN_SSE_OVERFLOW=coalesce|disconnect; GUARDIAN_SSE_MAX_LAG_S without draining closes it
+        SseOptions sse_options;
+        if (const char* env = std::getenv("GUARDIAN_SSE_QUEUE")) sse_options.max_queued_frames = (size_t)std::atoi(env);
+        if (const char* env = std::getenv("GUARDIAN_SSE_OVERFLOW"))
+            if (std::string(env) == "disconnect") sse_options.overflow = SseOptions::Overflow::Disconnect;
+        if (const char* env = std::getenv("GUARDIAN_SSE_MAX_LAG_S")) sse_options.max_lag_seconds = std::atoi(env);
+        if (sse_port > 0 && g_sse_server.start(sse_port, sse_options))
+            std::cout << "[sse] event stream on http://localhost:" << sse_port << "/events\n";
+        std::thread(run_events_broadcaster).detach(); // after the SSE server subscribed to it
+        // lapsed incidents are purged by the store's expiry timer, right when they lapse
+        STORE.start_expiry(g_scheduler, []() {
+            g_monitor_engine.poke();
+            g_state_changes.bump();
+            });
 
 
 
@@ -199,17 +695,7 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                 m.src = body.value("src", 0);
                 m.dst = body.value("dst", 0);
                 m.threshold_minutes = body.value("threshold", 3);
-                m.created_at = (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-
-                {
-                    std::lock_guard<std::mutex> lk(g_monitors_mutex);
-                    m.id = g_next_monitor_id++;
-                    g_monitors.push_back(m);
-                }
-
-                // signal SSE clients (they'll evaluate monitors on next tick)
-                g_events_flag.store(true);
-                g_events_cv.notify_all();
+                m.id = g_monitor_engine.add(m); // SSE clients are signalled once it has been evaluated
 
                 res.set_content(nlohmann::json({ {"monitor_id", m.id} }).dump(), "application/json");
             }
@@ -223,11 +709,8 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
         svr.Get("/monitors", [&set_cors](const httplib::Request&, httplib::Response& res) {
             set_cors(res);
             nlohmann::json arr = nlohmann::json::array();
-            {
-                std::lock_guard<std::mutex> lk(g_monitors_mutex);
-                for (const auto& m : g_monitors) {
-                    arr.push_back({ {"id", m.id}, {"src", m.src}, {"dst", m.dst}, {"threshold", m.threshold_minutes}, {"created_at", m.created_at} });
-                }
+            for (const auto& m : g_monitor_engine.list()) {
+                arr.push_back({ {"id", m.id}, {"src", m.src}, {"dst", m.dst}, {"threshold", m.threshold_minutes}, {"created_at", m.created_at} });
             }
             res.set_content(arr.dump(), "application/json");
             });
@@ -237,7 +720,25 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
         // /status
         svr.Get("/status", [&set_cors](const httplib::Request&, httplib::Response& res) {
             set_cors(res);
-            res.set_content(nlohmann::json({ {"status","ok"} }).dump(), "application/json");
+            Scheduler::Stats sched = g_scheduler.stats();
+            size_t simulations;
+            {
+                std::lock_guard<std::mutex> lg(g_simulations_mutex);
+                simulations = g_simulations.size();
+            }
+            res.set_content(nlohmann::json({
+                {"status","ok"},
+                {"sse_connections", g_sse_server.connection_count()},
+                {"scheduler", {
+                    {"queued", sched.queued},
+                    {"executed", sched.executed},
+                    {"cancelled", sched.cancelled},
+                    {"last_lateness_us", sched.last_lateness_us},
+                    {"max_lateness_us", sched.max_lateness_us},
+                    {"avg_lateness_us", sched.avg_lateness_us},
+                    {"pending_simulations", simulations}
+                }}
+                }).dump(), "application/json");
             });
 
         // POST /trip
@@ -267,6 +768,9 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                 inc.node_or_edge = body.value("node", 0);
                 inc.description = body.value("desc", std::string("reported incident"));
                 int id = STORE.add_incident(inc);
+                g_monitor_engine.poke();
+                g_state_changes.bump();
+                if (!await_route_overlay(STORE.incidents_version(), res)) return; // a /route right after sees it
                 res.set_content(nlohmann::json({ {"incident_id", id} }).dump(), "application/json");
                 std::cout << "[report] id=" << id << " node=" << inc.node_or_edge << " desc=" << inc.description << "\n";
             }
@@ -276,6 +780,31 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
             }
             });
 
+        // POST /incidents/bulk  (JSON array or NDJSON of {node, severity, desc, duration_s})
+        // all-or-nothing; the batch costs one store lock, one overlay rebuild and one /events wakeup
+        svr.Post("/incidents/bulk", [&set_cors, &GRAPH](const httplib::Request& req, httplib::Response& res) {
+            set_cors(res);
+            try {
+                std::vector<Incident> batch = parse_bulk_incidents(req.body, GRAPH.n);
+                int first = STORE.add_incidents(batch);
+                if (!batch.empty()) {
+                    g_monitor_engine.poke();
+                    g_state_changes.bump();
+                }
+                if (!await_route_overlay(STORE.incidents_version(), res)) return;
+                res.set_content(nlohmann::json({
+                    {"added", batch.size()},
+                    {"first_id", first},
+                    {"last_id", batch.empty() ? 0 : batch.back().id}
+                    }).dump(), "application/json");
+                std::cout << "[bulk] added " << batch.size() << " incidents\n";
+            }
+            catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(nlohmann::json({ {"error", e.what()} }).dump(), "application/json");
+            }
+            });
+
         // POST /simulate
         svr.Post("/simulate", [&set_cors](const httplib::Request& req, httplib::Response& res) {
             set_cors(res);
@@ -287,30 +816,68 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                 int severity = body.value("severity", 1);
                 int duration_s = body.value("duration_s", 60);
 
+                int simulation_id;
+                {
+                    // held across scheduling so the job cannot run (and unregister) first
+                    std::lock_guard<std::mutex> lg(g_simulations_mutex);
+                    simulation_id = g_next_simulation++;
+                    auto delay = std::chrono::milliseconds(delay_ms > 0 ? delay_ms : 100);
+                    g_simulations[simulation_id] = g_scheduler.after(delay, [simulation_id, node, desc, severity, duration_s]() {
+                        {
+                            std::lock_guard<std::mutex> lg(g_simulations_mutex);
+                            g_simulations.erase(simulation_id);
+                        }
+                        // add_incident syncs the journal; keep that off the timer thread
+                        g_deferred_writes.submit([node, desc, severity, duration_s]() {
+                            Incident inc;
+                            inc.node_or_edge = node;
+                            inc.description = desc;
+                            inc.severity = severity;
+                            auto now = (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+                            inc.timestamp = now;
+                            if (duration_s > 0) inc.expires_at = now + duration_s;
+                            int id = STORE.add_incident(inc);
+                            g_monitor_engine.poke();
+                            g_state_changes.bump();
+                            std::cout << "[simulate] injected incident id=" << id << " node=" << node
+                                << " severity=" << severity << " expires_at=" << inc.expires_at << "\n";
+                            });
+                        });
+                }
+
                 res.set_content(nlohmann::json({
                     {"scheduled", true},
+                    {"simulation_id", simulation_id},
                     {"node", node},
                     {"delay_ms", delay_ms},
                     {"severity", severity},
                     {"duration_s", duration_s}
                     }).dump(), "application/json");
 
-                std::thread([node, desc, delay_ms, severity, duration_s]() {
-                    if (delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
-                    else std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-                    Incident inc;
-                    inc.node_or_edge = node;
-                    inc.description = desc;
-                    inc.severity = severity;
-                    auto now = (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                    inc.timestamp = now;
-                    if (duration_s > 0) inc.expires_at = now + duration_s;
-                    int id = STORE.add_incident(inc);
-                    std::cout << "[simulate] injected incident id=" << id << " node=" << node
-                        << " severity=" << severity << " expires_at=" << inc.expires_at << "\n";
-                    }).detach();
+            }
+            catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(nlohmann::json({ {"error", e.what()} }).dump(), "application/json");
+            }
+            });
 
+        // POST /simulate/cancel  { "simulation_id": 3 }  (drops a scheduled injection that has not run yet)
+        svr.Post("/simulate/cancel", [&set_cors](const httplib::Request& req, httplib::Response& res) {
+            set_cors(res);
+            try {
+                auto body = nlohmann::json::parse(req.body);
+                int simulation_id = body.at("simulation_id").get<int>();
+                bool cancelled = false;
+                {
+                    std::lock_guard<std::mutex> lg(g_simulations_mutex);
+                    auto it = g_simulations.find(simulation_id);
+                    if (it != g_simulations.end()) {
+                        cancelled = g_scheduler.cancel(it->second);
+                        g_simulations.erase(it);
+                    }
+                }
+                if (!cancelled) res.status = 404;
+                res.set_content(nlohmann::json({ {"simulation_id", simulation_id}, {"cancelled", cancelled} }).dump(), "application/json");
             }
             catch (const std::exception& e) {
                 res.status = 400;
@@ -367,10 +934,13 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                 }
 
                 // store parsed events (replace existing in-memory calendar)
+                unsigned long long seq;
                 {
                     std::lock_guard<std::mutex> lg(g_calendar_mutex);
                     g_calendar_events = parsed; // overwrite easy demo behavior
+                    seq = g_journal.append(Journal::Type::CalendarSet, encode_calendar());
                 }
+                g_journal.sync(seq);
 
                 nlohmann::json out;
                 out["imported"] = (int)parsed.size();
@@ -386,8 +956,13 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
         svr.Post("/calendar/clear", [&set_cors](const httplib::Request& req, httplib::Response& res) {
             set_cors(res);
             try {
-                std::lock_guard<std::mutex> lg(g_calendar_mutex);
-                g_calendar_events.clear();
+                unsigned long long seq;
+                {
+                    std::lock_guard<std::mutex> lg(g_calendar_mutex);
+                    g_calendar_events.clear();
+                    seq = g_journal.append(Journal::Type::CalendarSet, encode_calendar());
+                }
+                g_journal.sync(seq);
                 res.set_content(nlohmann::json({ {"cleared", true}, {"count", 0} }).dump(), "application/json");
             }
             catch (const std::exception& e) {
@@ -411,10 +986,13 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                 CalendarEvent ev;
                 ev.start_epoch = epoch;
                 ev.summary = summary;
+                unsigned long long seq;
                 {
                     std::lock_guard<std::mutex> lg(g_calendar_mutex);
                     g_calendar_events.push_back(ev);
+                    seq = g_journal.append(Journal::Type::CalendarSet, encode_calendar());
                 }
+                g_journal.sync(seq);
                 res.set_content(nlohmann::json({ {"added", true}, {"start_epoch", epoch}, {"summary", summary} }).dump(), "application/json");
             }
             catch (const std::exception& e) {
@@ -430,9 +1008,7 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
         // GET /incidents
         svr.Get("/incidents", [&set_cors](const httplib::Request&, httplib::Response& res) {
             set_cors(res);
-            res.set_content(STORE.list_incidents().dump(), "application/json");
-            g_events_flag.store(true);
-            g_events_cv.notify_all();
+            res.set_content(STORE.snapshot()->json(), "application/json");
 
             });
 
@@ -441,7 +1017,13 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
             set_cors(res);
             try {
                 // ensure Store has a clear or do via existing API (we have map inside Store)
+                unsigned long long before = STORE.incidents_version();
                 STORE.clear_incidents(); // ADD this method if missing; otherwise add a small Store::clear wrapper
+                if (STORE.incidents_version() != before) {
+                    g_monitor_engine.poke();
+                    g_state_changes.bump();
+                }
+                if (!await_route_overlay(STORE.incidents_version(), res)) return;
                 res.set_content(nlohmann::json({ {"cleared", true} }).dump(), "application/json");
             }
             catch (const std::exception& e) {
@@ -472,20 +1054,18 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                 auto path_base = pair["baseline"]["path"].get<std::vector<int>>();
                 auto path_adj = pair["adjusted"]["path"].get<std::vector<int>>();
 
-                // notify SSE watchers that route/incidents may have changed
-                g_events_flag.store(true);
-                g_events_cv.notify_all();
-
                 // keep your DNA logging if you want to record impacts
                 if (eta_base >= 0 && eta_adj >= 0 && eta_adj > eta_base) {
                     long long diff = eta_adj - eta_base;
-                    auto incidents = STORE.get_incidents_copy();
+                    auto snap = STORE.snapshot();
+                    const auto& incidents = snap->incidents;
                     if (!incidents.empty()) {
                         DNA.logIncidentImpact(
-                            incidents[0].node_or_edge,
-                            incidents[0].severity,
+                            incidents.front().node_or_edge,
+                            incidents.front().severity,
                             diff
                         );
+                        g_state_changes.bump(); // DNA summary changed
                     }
                 }
                                 // --- DNA prediction (safe) ---
@@ -574,6 +1154,84 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
             }
             });
 
+        // batch of {src,dst} pairs -> {"routes":[{src,dst,baseline,adjusted}, ...]} in input order
+        svr.Post("/route/batch", [&set_cors, &GRAPH](const httplib::Request& req, httplib::Response& res) {
+            set_cors(res);
+            try {
+                auto body = nlohmann::json::parse(req.body);
+                const auto& list = body.is_array() ? body : body.at("pairs");
+                if (!list.is_array() || list.size() > kMaxBatchPairs) {
+                    res.status = 400;
+                    res.set_content(nlohmann::json({ {"error","pairs must be an array of at most " + std::to_string(kMaxBatchPairs) + " {src,dst}"} }).dump(), "application/json");
+                    return;
+                }
+                std::vector<std::pair<int, int>> pairs;
+                pairs.reserve(list.size());
+                for (const auto& p : list) pairs.push_back({ p.value("src", -1), p.value("dst", -1) });
+
+                nlohmann::json r;
+                r["routes"] = compute_route_batch(GRAPH, pairs);
+                res.set_content(r.dump(), "application/json");
+            }
+            catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(nlohmann::json({ {"error", e.what()} }).dump(), "application/json");
+            }
+            });
+
+        // ETA matrix: {"sources":[..],"targets":[..],"metric":"baseline"|"adjusted"}
+        // -> {"metric":..,"rows":R,"cols":C,"eta_minutes":[row-major R*C, -1 = unreachable]}, streamed by row blocks
+        svr.Post("/matrix", [&set_cors, &GRAPH](const httplib::Request& req, httplib::Response& res) {
+            set_cors(res);
+            try {
+                auto body = nlohmann::json::parse(req.body);
+                auto job = std::make_shared<MatrixJob>();
+                job->sources = body.at("sources").get<std::vector<NodeId>>();
+                job->targets = body.at("targets").get<std::vector<NodeId>>();
+                std::string metric = body.value("metric", std::string("baseline"));
+                bool bad = metric != "baseline" && metric != "adjusted";
+                bad = bad || job->sources.size() > kMaxMatrixSide || job->targets.size() > kMaxMatrixSide;
+                for (NodeId v : job->sources) bad = bad || v < 0 || v >= GRAPH.n;
+                for (NodeId v : job->targets) bad = bad || v < 0 || v >= GRAPH.n;
+                if (bad) {
+                    res.status = 400;
+                    res.set_content(nlohmann::json({ {"error","expected metric baseline|adjusted and at most " + std::to_string(kMaxMatrixSide) + " valid sources/targets"} }).dump(), "application/json");
+                    return;
+                }
+
+                // same multipliers as compute_route_pair
+                const UpwardGraph* h = nullptr;
+                if (metric == "adjusted") {
+                    job->overlay = g_route_penalties.current();
+                    h = job->overlay->cch.get();
+                }
+                else if (g_baseline_ch.node_count() == GRAPH.n) {
+                    h = &g_baseline_ch.upward();
+                }
+                if (h) job->table = std::make_unique<DistanceTable>(*h, job->targets);
+
+                std::string head = "{\"metric\":\"" + metric + "\",\"rows\":" + std::to_string(job->sources.size())
+                    + ",\"cols\":" + std::to_string(job->targets.size()) + ",\"eta_minutes\":[";
+                res.set_chunked_content_provider(
+                    "application/json",
+                    [&GRAPH, job, head](size_t offset, httplib::DataSink& sink) -> bool {
+                        if (offset == 0 && !sink.write(head.data(), head.size())) return false;
+                        if (job->next_row < job->sources.size() && !job->targets.empty()) {
+                            size_t count = std::min(kMatrixRowsPerChunk, job->sources.size() - job->next_row);
+                            std::string rows = matrix_rows(GRAPH, *job, count);
+                            return sink.write(rows.data(), rows.size());
+                        }
+                        sink.write("]}", 2);
+                        sink.done();
+                        return true;
+                    });
+            }
+            catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(nlohmann::json({ {"error", e.what()} }).dump(), "application/json");
+            }
+            });
+
         svr.Get("/dna", [&set_cors](const httplib::Request&, httplib::Response& res) {
             set_cors(res);
             try {
@@ -613,39 +1271,7 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                     return;
                 }
 
-                auto compute_route_pair = [&GRAPH](int src, int dst) -> nlohmann::json {
-                    Graph baseline = GRAPH;
-                    Graph adjusted = GRAPH;
-                    auto incidents = STORE.get_incidents_copy();
-
-                    for (const auto& inc : incidents) {
-                        int node = inc.node_or_edge;
-                        double multiplier = (inc.severity <= 1) ? 1.5 : (inc.severity == 2 ? 2.2 : 3.0);
-
-                        for (auto& e : adjusted.adj[node])
-                            e.w = static_cast<long long>(std::ceil(e.w * multiplier));
-
-                        for (int u = 0; u < adjusted.n; ++u)
-                            for (auto& e : adjusted.adj[u])
-                                if (e.to == node)
-                                    e.w = static_cast<long long>(std::ceil(e.w * multiplier));
-                    }
-
-                    auto res_base = dijkstra(baseline, src);
-                    auto path_base = recover_path(res_base, src, dst);
-                    long long eta_base = (res_base.dist[dst] == INF) ? -1 : res_base.dist[dst];
-
-                    auto res_adj = dijkstra(adjusted, src);
-                    auto path_adj = recover_path(res_adj, src, dst);
-                    long long eta_adj = (res_adj.dist[dst] == INF) ? -1 : res_adj.dist[dst];
-
-                    nlohmann::json r;
-                    r["baseline"] = { {"path", path_base}, {"eta_minutes", eta_base} };
-                    r["adjusted"] = { {"path", path_adj}, {"eta_minutes", eta_adj} };
-                    return r;
-                    };
-
-                auto pair = compute_route_pair(src, dst);
+                auto pair = compute_route_pair(GRAPH, src, dst);
 
                 long long eta_base = pair["baseline"]["eta_minutes"].get<long long>();
                 long long eta_adj = pair["adjusted"]["eta_minutes"].get<long long>();
@@ -659,8 +1285,7 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
 
                 // Debug/logging for predict
                 try {
-                    auto incs_json = STORE.list_incidents();
-                    size_t inc_count = incs_json.is_array() ? inc_count = incs_json.size() : 0;
+                    size_t inc_count = STORE.snapshot()->incidents.size();
                     std::cout << "[PREDICT] src=" << src
                         << " dst=" << dst
                         << " eta_base=" << eta_base
@@ -748,6 +1373,7 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                                 g_dna_alerts.push_back(alert);
                                 if (g_dna_alerts.size() > 50) g_dna_alerts.erase(g_dna_alerts.begin());
                             }
+                            g_state_changes.bump();
                         }
                         catch (...) {
                             // non-fatal: continue without crashing if recording fails
@@ -780,10 +1406,13 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
                     auto body = nlohmann::json::parse(req.body);
                     auto name = body.value("name", std::string());
                     if (name.empty()) { res.status = 400; res.set_content(nlohmann::json({ {"error","missing name"} }).dump(), "application/json"); return; }
+                    unsigned long long seq;
                     {
                         std::lock_guard<std::mutex> lg(g_personas_mutex);
                         g_personas[name] = body;
+                        seq = g_journal.append(Journal::Type::PersonaPut, encode_persona(name, body));
                     }
+                    g_journal.sync(seq);
                     res.set_content(nlohmann::json({ {"saved", true}, {"name", name} }).dump(), "application/json");
                 }
                 catch (const std::exception& e) {
@@ -805,235 +1434,50 @@ nlohmann::json compute_route_pair(const Graph& GRAPH, int src, int dst) {
 
 
         // --- GET /events SSE (cleaned) ---
-        svr.Get("/events", [&set_cors, &GRAPH](const httplib::Request&, httplib::Response& res) {
+        svr.Get("/events", [&set_cors](const httplib::Request& req, httplib::Response& res) {
             set_cors(res);
             res.set_header("Content-Type", "text/event-stream");
             res.set_header("Cache-Control", "no-cache");
             res.set_header("Connection", "keep-alive");
 
-            // last incidents string used to avoid re-sending identical payloads
-            std::string last_incidents_str;
-
+            // payloads are built by run_events_broadcaster; a connection only writes shared frames.
+            // A reconnecting EventSource sends Last-Event-ID and gets just the frames it missed.
+            // Query parameters select topics, see Subscription.
+            unsigned long long last_id = std::strtoull(req.get_header_value("Last-Event-ID").c_str(), nullptr, 10);
+            Subscription sub;
+            try {
+                size_t q = req.target.find('?');
+                if (q != std::string::npos) sub = Subscription::parse(req.target.substr(q + 1));
+            }
+            catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(nlohmann::json({ {"error", e.what()} }).dump(), "application/json");
+                return;
+            }
             res.set_chunked_content_provider(
                 "text/event-stream",
-                [&GRAPH, last_incidents_str = std::string()](size_t /*offset*/, httplib::DataSink& sink) mutable -> bool {
-                   // send initial greeting (check writability)
-                    std::string init = "event: connected\ndata: {\"status\":\"ok\"}\n\n";
+                [last_id, sub](size_t /*offset*/, httplib::DataSink& sink) -> bool {
+                    static const std::string init = "event: connected\ndata: {\"status\":\"ok\"}\n\n";
+                    static const std::string heartbeat = "data: {\"heartbeat\":true}\n\n";
                     if (!sink.is_writable() || !sink.write(init.c_str(), init.size())) {
                         return false;
                     }
-                    std::unique_lock<std::mutex> lk(g_events_mutex);
-
-                    // heartbeat counter (keeps heart local to lambda)
-                    int heartbeat_counter = 0;
-
-                    while (sink.is_writable()) {
-                        // Wait until notified or timeout (keeps connection alive)
-                        g_events_cv.wait_for(lk, std::chrono::seconds(2));
-
-                        // Release the g_events_mutex quickly — do not hold while calling STORE/DNA/compute
-                        lk.unlock();
-
-                        try {
-                            // 1) Get a safe copy of incidents (STORE should return by value)
-                            nlohmann::json incidents_json;
-                            try {
-                                incidents_json = STORE.list_incidents(); // MUST return by value and be thread-safe
-                            }
-                            catch (...) {
-                                incidents_json = nlohmann::json::array();
-                            }
-                            const std::string incidents_str = incidents_json.dump();
-
-                            // THOU SHALL Build THAT payload JSON locally IF NOT MIGHT HAVE TO BRUTE FORCE THIS MFER
-                            nlohmann::json payload;
-                            payload["incidents"] = incidents_json;
-
-                            // Add DNA summary safely (normalize to { node_stats: { node: { avg_delay, count } } })
-                                                        // Add DNA summary safely (normalize to { node_stats: { node: { avg_delay, count } } })
-                            try {
-                                auto dna_json_str = DNA.exportSummaryJSON(); // must be thread-safe
-                                nlohmann::json dna_out = nlohmann::json::object();
-
-                                if (dna_json_str.empty() || dna_json_str == "null") {
-                                    dna_out["node_stats"] = nlohmann::json::object();
-                                }
-                                else {
-                                    auto parsed = nlohmann::json::parse(dna_json_str);
-                                    // If parsed is an array of {node, severity, avg_delay, samples}
-                                    if (parsed.is_array()) {
-                                        nlohmann::json node_stats = nlohmann::json::object();
-                                        for (auto& item : parsed) {
-                                            try {
-                                                int node = item.value("node", -1);
-                                                double avg = item.value("avg_delay", 0.0);
-                                                int samples = item.value("samples", 0);
-                                                if (node < 0) continue;
-                                                std::string key = std::to_string(node);
-
-                                                // ensure object exists
-                                                if (!node_stats.contains(key) || !node_stats[key].is_object()) {
-                                                    node_stats[key] = nlohmann::json::object();
-                                                    node_stats[key]["avg_delay"] = 0.0;
-                                                    node_stats[key]["count"] = 0;
-                                                }
-
-                                                double prev_avg = node_stats[key].value("avg_delay", 0.0);
-                                                int prev_count = node_stats[key].value("count", 0);
-
-                                                // aggregate: keep the maximum average delay seen across severities,
-                                                // and sum samples as a simple count.
-                                                double new_avg = std::max(prev_avg, avg);
-                                                int new_count = prev_count + samples;
-
-                                                node_stats[key]["avg_delay"] = new_avg;
-                                                node_stats[key]["count"] = new_count;
-                                            }
-                                            catch (...) { /* ignore bad items */ }
-                                        }
-                                        dna_out["node_stats"] = node_stats;
-                                    }
-                                    // If parsed is an object and already contains node_stats, use it directly
-                                    else if (parsed.is_object() && parsed.contains("node_stats")) {
-                                        // normalize to our preferred shape (ensure node entries are objects)
-                                        nlohmann::json node_stats = nlohmann::json::object();
-                                        for (auto it = parsed["node_stats"].begin(); it != parsed["node_stats"].end(); ++it) {
-                                            const std::string key = it.key();
-                                            auto val = it.value();
-                                            if (val.is_object()) {
-                                                double avg = val.value("avg_delay", 0.0);
-                                                int cnt = val.value("count", 0);
-                                                node_stats[key] = nlohmann::json::object();
-                                                node_stats[key]["avg_delay"] = avg;
-                                                node_stats[key]["count"] = cnt;
-                                            }
-                                            else {
-                                                // if value isn't object, skip or set defaults
-                                                node_stats[key] = nlohmann::json::object();
-                                                node_stats[key]["avg_delay"] = 0.0;
-                                                node_stats[key]["count"] = 0;
-                                            }
-                                        }
-                                        dna_out["node_stats"] = node_stats;
-                                    }
-                                    // otherwise return the parsed object under "raw" and provide empty node_stats
-                                    else {
-                                        dna_out["raw"] = parsed;
-                                        dna_out["node_stats"] = nlohmann::json::object();
-                                    }
-                                }
-                                payload["dna_summary"] = dna_out;
-                            }
-                            catch (...) {
-                                payload["dna_summary"] = nlohmann::json::object();
-                            }
-
 
-
-                            // We shall Evaluate monitors using copies (avoid long locks)
-                            std::vector<Monitor> monitors_copy;
-                            {
-                                std::lock_guard<std::mutex> lg(g_monitors_mutex);
-                                monitors_copy = g_monitors; // copy under monitor mutex
-                            }
-
-                            if (!monitors_copy.empty()) {
-                                nlohmann::json alerts = nlohmann::json::array();
-
-                                const long long ADD_PENALTY_MINOR = 2;
-                                const long long ADD_PENALTY_MODERATE = 5;
-                                const long long ADD_PENALTY_MAJOR = 10;
-
-                                for (const auto& m : monitors_copy) {
-                                    if (m.src < 0 || m.dst < 0 || m.src >= GRAPH.n || m.dst >= GRAPH.n) continue;
-
-                                    // Use a local snapshot of the graph (copy)
-                                    Graph baseline = GRAPH;
-                                    Graph adjusted = GRAPH;
-
-                                    // apply additive penalties per current incidents
-                                    auto incs = STORE.get_incidents_copy(); // must be thread-safe and return copy
-                                    for (const auto& inc : incs) {
-                                        int node = inc.node_or_edge;
-                                        if (node < 0 || node >= adjusted.n) continue;
-                                        long long add = (inc.severity <= 1) ? ADD_PENALTY_MINOR :
-                                            (inc.severity == 2) ? ADD_PENALTY_MODERATE : ADD_PENALTY_MAJOR;
-                                        for (auto& e : adjusted.adj[node]) e.w += add;
-                                        for (int u = 0; u < adjusted.n; ++u)
-                                            for (auto& e : adjusted.adj[u])
-                                                if (e.to == node) e.w += add;
-                                    }
-
-                                    // compute routes (using local graphs)
-                                    auto rb = dijkstra(baseline, m.src);
-                                    auto path_b = recover_path(rb, m.src, m.dst);
-                                    long long eta_b = (rb.dist[m.dst] == INF) ? -1 : rb.dist[m.dst];
-
-                                    auto ra = dijkstra(adjusted, m.src);
-                                    auto path_a = recover_path(ra, m.src, m.dst);
-                                    long long eta_a = (ra.dist[m.dst] == INF) ? -1 : ra.dist[m.dst];
-
-                                    if (eta_b >= 0 && eta_a >= 0) {
-                                        long long delta = eta_a - eta_b;
-                                        if (delta >= m.threshold_minutes) {
-                                            alerts.push_back({
-                                                {"monitor_id", m.id},
-                                                {"src", m.src},
-                                                {"dst", m.dst},
-                                                {"eta_base", eta_b},
-                                                {"eta_adj", eta_a},
-                                                {"delta", delta},
-                                                {"timestamp", (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())}
-                                                });
-                                        }
-                                    }
-                                } // for monitors
-
-                                if (!alerts.empty()) payload["monitor_alerts"] = alerts;
-                                // copy dna alerts under lock, then attach (and optionally clear)
-                                nlohmann::json dna_copy = nlohmann::json::array();
-                                {
-                                    std::lock_guard<std::mutex> lg(g_dna_alerts_mutex);
-                                    if (!g_dna_alerts.empty()) {
-                                        dna_copy = g_dna_alerts;
-                                        // OPTIONAL: if you want one-shot semantics for this connection, uncomment:
-                                        // g_dna_alerts.clear();
-                                    }
-                                }
-                                payload["dna_alerts"] = dna_copy;
-
-                            } // if monitors
-
-                            // 4) Decide whether to send (last_incidents_str is local per-connection so safe)
-                            if (incidents_str != last_incidents_str) {
-                                last_incidents_str = incidents_str;
-                                const std::string msg = "data: " + payload.dump() + "\n\n";
-                                if (!sink.is_writable()) break;
-                                if (!sink.write(msg.c_str(), msg.size())) break;
-                                heartbeat_counter = 0;
-                            }
-                            else {
-                                // heartbeat roughly every 5 cycles (~10s)
-                                if (++heartbeat_counter % 5 == 0) {
-                                    const std::string hk = "data: {\"heartbeat\":true}\n\n";
-                                    if (!sink.is_writable()) break;
-                                    if (!sink.write(hk.c_str(), hk.size())) break;
-                                }
-                            }
+                    unsigned long long seen = last_id;
+                    bool ok = true;
+                    for (const auto& e : g_events_broadcaster.since(seen, sub)) ok = ok && sink.write(e.frame->data(), e.frame->size());
+                    int idle = 0;
+                    while (ok && sink.is_writable()) {
+                        auto events = g_events_broadcaster.wait_next(seen, std::chrono::seconds(2), sub);
+                        if (!events.empty()) {
+                            for (const auto& e : events) ok = ok && sink.write(e.frame->data(), e.frame->size());
+                            idle = 0;
                         }
-                        catch (const std::exception& ex) {
-                            // send error message but don't rethrow
-                            try {
-                                const std::string err = std::string("data: ") + nlohmann::json({ {"error", ex.what()} }).dump() + "\n\n";
-                                if (sink.is_writable()) sink.write(err.c_str(), err.size());
-                            }
-                            catch (...) {}
-                            break;
+                        // heartbeat roughly every 5 idle cycles (~10s)
+                        else if (++idle % 5 == 0) {
+                            if (!sink.write(heartbeat.data(), heartbeat.size())) break;
                         }
-
-                        // re-lock and loop again (wait)
-                        lk.lock();
-                    } // while
+                    }
                     return true;
                 }
             );
@@ -0,0 +1,381 @@
+#include "sse_server.hpp"
+#include <iostream>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+const int kHeartbeatSeconds = 10;
+const int kWheelSlots = 16;            // one-second slots; must exceed kHeartbeatSeconds
+const size_t kMaxRequestBytes = 8192;
+
+const Broadcaster::Frame kResponseHead = std::make_shared<const std::string>(
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n"
+    "event: connected\ndata: {\"status\":\"ok\"}\n\n");
+const Broadcaster::Frame kHeartbeat = std::make_shared<const std::string>("data: {\"heartbeat\":true}\n\n");
+const std::string kNotFound = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const std::string kBadRequest = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const int kTopicCount = 3;             // bits of EventTags::Topic
+
+struct Connection {
+    unsigned long long id = 0;
+    bool streaming = false;                 // request parsed, response head queued
+    std::string request;                    // header bytes until the blank line
+    std::deque<Broadcaster::Frame> queue;   // shared frames waiting for the socket
+    size_t offset = 0;                      // bytes of queue.front() already sent
+    bool want_write = false;                // EPOLLOUT registered
+    long long heartbeat_due = 0;            // tick at which an idle stream gets a heartbeat
+    long long stalled_since = -1;           // tick the socket last refused data with frames queued
+    long long wheel_due = 0;                // tick of its live timer wheel entry
+    unsigned long long seen = 0;            // id of the newest frame queued
+    std::string group;                      // Subscription::key() of its filter
+};
+
+// Streaming connections with the same filter. A frame is matched once per group.
+struct Group {
+    Subscription sub;
+    std::unordered_set<int> members;
+};
+
+// Value of the Last-Event-ID request header, 0 if absent.
+unsigned long long last_event_id(const std::string& request) {
+    static const std::string name = "last-event-id:";
+    std::string lower(request);
+    for (auto& ch : lower) ch = (char)std::tolower((unsigned char)ch);
+    size_t at = lower.find("\r\n" + name);
+    if (at == std::string::npos) return 0;
+    return std::strtoull(request.c_str() + at + 2 + name.size(), nullptr, 10);
+}
+
+// Hashed timer wheel with one-second slots. An entry (fd, connection id) can outlive its
+// connection or be superseded (Connection::wheel_due); whoever takes a slot re-checks.
+class TimerWheel {
+public:
+    using Entry = std::pair<int, unsigned long long>;
+    TimerWheel() : slots_(kWheelSlots) {}
+    void schedule(long long tick, int fd, unsigned long long id) { slots_[tick % kWheelSlots].push_back({ fd, id }); }
+    std::vector<Entry> take(long long tick) {
+        std::vector<Entry> out;
+        out.swap(slots_[tick % kWheelSlots]);
+        return out;
+    }
+
+private:
+    std::vector<std::vector<Entry>> slots_;
+};
+
+} // namespace
+
+bool SseServer::start(int port, SseOptions options) {
+    options_ = options;
+    if (options_.max_queued_frames < 2) options_.max_queued_frames = 2;
+    int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (lfd < 0) return false;
+    int on = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(lfd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, SOMAXCONN) < 0) {
+        std::cerr << "[sse] cannot listen on port " << port << ": " << std::strerror(errno) << "\n";
+        close(lfd);
+        return false;
+    }
+    int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        close(lfd);
+        return false;
+    }
+    source_.add_listener([wake_fd]() {
+        uint64_t one = 1;
+        ssize_t r = write(wake_fd, &one, sizeof(one));
+        (void)r;
+    });
+    std::thread([this, lfd, wake_fd]() { run(lfd, wake_fd); }).detach();
+    return true;
+}
+
+void SseServer::run(int listen_fd, int wake_fd) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.fd = wake_fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, wake_fd, &ev);
+
+    std::unordered_map<int, Connection> conns;
+    std::unordered_map<std::string, Group> groups;   // by Subscription::key()
+    std::vector<Group*> all_groups;
+    std::vector<Group*> by_topic[kTopicCount];       // groups subscribed to each topic bit
+    auto reindex = [&]() {
+        all_groups.clear();
+        for (auto& topic : by_topic) topic.clear();
+        for (auto& [key, g] : groups) {
+            all_groups.push_back(&g);
+            for (int t = 0; t < kTopicCount; ++t)
+                if (g.sub.topics & (1u << t)) by_topic[t].push_back(&g);
+        }
+    };
+    TimerWheel wheel;
+    unsigned long long next_id = 1;
+    unsigned long long seen_version = source_.version();
+    auto t0 = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&t0]() {
+        return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    };
+    long long tick = 0;
+
+    auto drop = [&](int fd) {
+        auto it = conns.find(fd);
+        if (it != conns.end() && it->second.streaming) {
+            auto g = groups.find(it->second.group);
+            g->second.members.erase(fd);
+            if (g->second.members.empty()) { groups.erase(g); reindex(); }
+        }
+        epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        conns.erase(fd);
+        --connections_;
+    };
+    // books a wheel visit at `due` unless an earlier one is pending; at most a wheel turn ahead
+    auto arm = [&](int fd, Connection& c, long long due) {
+        due = std::max(tick + 1, std::min(due, tick + kWheelSlots - 1));
+        if (c.wheel_due > tick && c.wheel_due <= due) return;
+        c.wheel_due = due;
+        wheel.schedule(due, fd, c.id);
+    };
+    auto set_write_interest = [&](int fd, Connection& c, bool on) {
+        if (c.want_write == on) return;
+        c.want_write = on;
+        epoll_event mod{};
+        mod.events = EPOLLIN | EPOLLRDHUP | (on ? (uint32_t)EPOLLOUT : 0u);
+        mod.data.fd = fd;
+        epoll_ctl(ep, EPOLL_CTL_MOD, fd, &mod);
+    };
+    // writes as much of the queue as the socket takes; false if the connection died
+    auto flush = [&](int fd, Connection& c) {
+        while (!c.queue.empty()) {
+            const std::string& f = *c.queue.front();
+            ssize_t n = send(fd, f.data() + c.offset, f.size() - c.offset, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    set_write_interest(fd, c, true);
+                    if (c.stalled_since < 0) {
+                        c.stalled_since = tick;
+                        if (options_.max_lag_seconds > 0) arm(fd, c, tick + options_.max_lag_seconds);
+                    }
+                    return true;
+                }
+                if (errno == EINTR) continue;
+                return false;
+            }
+            c.offset += (size_t)n;
+            if (c.offset == f.size()) {
+                c.queue.pop_front();
+                c.offset = 0;
+                c.heartbeat_due = tick + kHeartbeatSeconds;
+            }
+        }
+        set_write_interest(fd, c, false);
+        c.stalled_since = -1;
+        return true;
+    };
+    // false if the connection has to go (full queue under Overflow::Disconnect, or a dead socket)
+    auto enqueue = [&](int fd, Connection& c, const Broadcaster::Frame& f) {
+        if (f != kResponseHead && c.queue.size() >= options_.max_queued_frames) {
+            if (options_.overflow == SseOptions::Overflow::Disconnect || !c.streaming) return false;
+            // Every published frame is covered by the keyframe, so it supersedes the unsent
+            // backlog and `f`. A half-written frame has to finish first, and the response
+            // head (with anything before it) must still go out ahead of the keyframe.
+            size_t keep = c.offset > 0 ? 1 : 0;
+            auto head = std::find(c.queue.begin(), c.queue.end(), kResponseHead);
+            if (head != c.queue.end()) keep = std::max(keep, (size_t)(head - c.queue.begin()) + 1);
+            c.queue.resize(keep);
+            unsigned long long id = 0;
+            Broadcaster::Frame k = source_.keyframe(groups.at(c.group).sub, &id);
+            if (k) c.queue.push_back(k);
+            c.seen = std::max(c.seen, id);
+            return true; // still waiting for EPOLLOUT
+        }
+        c.queue.push_back(f);
+        return c.queue.size() > 1 ? true : flush(fd, c); // a backlog is drained by EPOLLOUT
+    };
+    // parses the request once the headers are complete; false closes the connection
+    auto on_request = [&](int fd, Connection& c) {
+        size_t line_end = c.request.find("\r\n");
+        std::string line = c.request.substr(0, line_end);
+        bool ok = line.rfind("GET /events", 0) == 0 &&
+            (line.size() == 11 || line[11] == ' ' || line[11] == '?');
+        if (!ok) {
+            ssize_t r = send(fd, kNotFound.data(), kNotFound.size(), MSG_NOSIGNAL);
+            (void)r;
+            return false;
+        }
+        Subscription sub;
+        try {
+            if (line[11] == '?') sub = Subscription::parse(line.substr(12, line.find(' ', 12) - 12));
+        }
+        catch (const std::exception&) {
+            ssize_t r = send(fd, kBadRequest.data(), kBadRequest.size(), MSG_NOSIGNAL);
+            (void)r;
+            return false;
+        }
+        c.group = sub.key();
+        auto g = groups.find(c.group);
+        if (g == groups.end()) {
+            g = groups.emplace(c.group, Group{ sub, {} }).first;
+            reindex();
+        }
+        g->second.members.insert(fd);
+        c.streaming = true;
+        c.heartbeat_due = tick + kHeartbeatSeconds;
+        c.seen = last_event_id(c.request);
+        c.request.clear();
+        c.request.shrink_to_fit();
+        if (!enqueue(fd, c, kResponseHead)) return false;
+        // missed frames after a reconnect, otherwise the keyframe
+        for (const auto& e : source_.since(c.seen, sub))
+            if (!enqueue(fd, c, e.frame)) return false;
+        return true;
+    };
+
+    std::vector<epoll_event> events(256);
+    char buf[4096];
+    while (true) {
+        int timeout = (int)(1000 - elapsed_ms() % 1000);
+        int ready = epoll_wait(ep, events.data(), (int)events.size(), timeout);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "[sse] epoll_wait failed: " << std::strerror(errno) << "\n";
+            return;
+        }
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t what = events[i].events;
+
+            if (fd == listen_fd) {
+                while (true) {
+                    int cfd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (cfd < 0) break;
+                    Connection& c = conns[cfd];
+                    c = Connection{};
+                    c.id = next_id++;
+                    c.heartbeat_due = tick + kHeartbeatSeconds; // doubles as the request deadline
+                    arm(cfd, c, c.heartbeat_due);
+                    ++connections_;
+                    epoll_event add{};
+                    add.events = EPOLLIN | EPOLLRDHUP;
+                    add.data.fd = cfd;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, cfd, &add);
+                }
+                continue;
+            }
+
+            if (fd == wake_fd) {
+                uint64_t count;
+                ssize_t r = read(wake_fd, &count, sizeof(count));
+                (void)r;
+                auto frames = source_.since(seen_version); // everything; matched per group below
+                if (frames.empty()) continue;
+                std::unordered_set<int> lagging;
+                for (const auto& e : frames) {
+                    unsigned t = e.tags.topic;
+                    bool one_topic = t && !(t & (t - 1));
+                    const auto& targets = e.keyframe || !one_topic ? all_groups : by_topic[__builtin_ctz(t)];
+                    for (Group* g : targets) {
+                        // a keyframe is rendered (once, cached) for each subscription
+                        Broadcaster::Frame f = e.keyframe ? source_.keyframe(g->sub) : e.frame;
+                        if (!f || (!e.keyframe && !g->sub.matches(e.tags))) continue;
+                        for (int cfd : g->members) {
+                            Connection& c = conns[cfd];
+                            if (e.id <= c.seen || lagging.count(cfd)) continue; // already sent on resume
+                            if (!enqueue(cfd, c, f)) lagging.insert(cfd);
+                        }
+                    }
+                }
+                for (auto& g : all_groups)
+                    for (int cfd : g->members) conns[cfd].seen = std::max(conns[cfd].seen, seen_version);
+                for (int cfd : lagging) drop(cfd);
+                continue;
+            }
+
+            auto it = conns.find(fd);
+            if (it == conns.end()) continue;
+            Connection& c = it->second;
+            if (what & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) { drop(fd); continue; }
+            if (what & EPOLLOUT) {
+                if (!flush(fd, c)) { drop(fd); continue; }
+            }
+            if (what & EPOLLIN) {
+                bool alive = true;
+                while (alive) {
+                    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                    if (n > 0) {
+                        if (c.streaming) continue; // a stream has nothing more to say
+                        c.request.append(buf, (size_t)n);
+                        if (c.request.find("\r\n\r\n") != std::string::npos) alive = on_request(fd, c);
+                        else if (c.request.size() > kMaxRequestBytes) alive = false;
+                        continue;
+                    }
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    if (n < 0 && errno == EINTR) continue;
+                    alive = false; // orderly shutdown or error
+                }
+                if (!alive) drop(fd);
+            }
+        }
+
+        // heartbeats for streams that have been quiet since their last frame; connections
+        // that never finished their request or stopped reading for too long are closed
+        for (long long now = elapsed_ms() / 1000; tick < now; ) {
+            ++tick;
+            for (const auto& [fd, id] : wheel.take(tick)) {
+                auto it = conns.find(fd);
+                if (it == conns.end() || it->second.id != id || it->second.wheel_due != tick) continue;
+                Connection& c = it->second;
+                c.wheel_due = 0;
+                if (!c.streaming) { drop(fd); continue; }
+                bool stalled = c.stalled_since >= 0 && options_.max_lag_seconds > 0;
+                if (stalled && tick - c.stalled_since >= options_.max_lag_seconds) { drop(fd); continue; }
+                if (c.heartbeat_due <= tick) {
+                    if (c.queue.empty() && !enqueue(fd, c, kHeartbeat)) { drop(fd); continue; }
+                    c.heartbeat_due = tick + kHeartbeatSeconds;
+                }
+                arm(fd, c, stalled ? std::min(c.heartbeat_due, c.stalled_since + options_.max_lag_seconds) : c.heartbeat_due);
+            }
+        }
+    }
+}
+
+#else
+
+bool SseServer::start(int port, SseOptions) {
+    std::cerr << "[sse] event-loop server on port " << port << " is only available on Linux\n";
+    return false;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include "broadcaster.hpp"
+
+// Standalone server-sent events endpoint on its own port. One epoll thread owns every
+// connection (non-blocking sockets, per-connection write queues), so idle dashboards
+// cost a few hundred bytes each instead of an httplib worker thread. Heartbeats are
+// scheduled on a timer wheel. Serves `GET /events` with the frames of one Broadcaster.
+// Query parameters select topics (see Subscription); connections with the same filter
+// form a group, indexed by topic, so each frame is matched once per group.
+// Linux only; start() returns false elsewhere.
+//
+// Each connection's outbound queue is bounded; what happens to a client that falls
+// behind is set by SseOptions. Heartbeats are only queued on an empty queue, so they
+// never compete with real frames.
+struct SseOptions {
+    enum class Overflow {
+        Coalesce,   // replace the unsent backlog with the current keyframe (newest state)
+        Disconnect  // close the connection
+    };
+    size_t max_queued_frames = 64;
+    Overflow overflow = Overflow::Coalesce;
+    int max_lag_seconds = 30;   // close a client whose queue has not drained for this long; 0 = never
+};
+
+class SseServer {
+public:
+    explicit SseServer(Broadcaster& source) : source_(source) {}
+
+    // Binds 0.0.0.0:port and spawns the event loop thread.
+    bool start(int port, SseOptions options = SseOptions());
+
+    size_t connection_count() const { return connections_.load(); }
+
+private:
+    void run(int listen_fd, int wake_fd);
+
+    Broadcaster& source_;
+    SseOptions options_;
+    std::atomic<size_t> connections_{ 0 };
+};
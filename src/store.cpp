@@ -1,5 +1,14 @@
 #include "store.hpp"
+#include <algorithm>
+#include <charconv>
 #include <chrono>
+#include <iterator>
+
+static const size_t kMaxIncidentDeltas = 4096;
+
+static long long now_epoch() {
+    return (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+}
 
 // Convert Incident struct to JSON
 nlohmann::json to_json(const Incident& inc) {
@@ -13,84 +22,360 @@ nlohmann::json to_json(const Incident& inc) {
     };
 }
 
-Store::Store() : nextTrip_(1), nextIncident_(1) {}
+static Journal::Encoder encode(const Incident& inc) {
+    Journal::Encoder e;
+    e.i32(inc.id).i32(inc.node_or_edge).i32(inc.severity)
+        .i64(inc.timestamp).i64(inc.expires_at).str(inc.description);
+    return e;
+}
+
+static Journal::Encoder encode(const Trip& t) {
+    Journal::Encoder e;
+    e.i32(t.id).i32(t.src).i32(t.dst).i64(t.start_time).i32(t.active ? 1 : 0).str(t.user);
+    return e;
+}
+
+Store::Store() : incidentsVersion_(0), nextTrip_(1), nextIncident_(1) {
+    snapshot_ = std::make_shared<IncidentSnapshot>();
+}
 
 int Store::add_trip(const Trip& t) {
-    std::lock_guard<std::mutex> g(mutex_);
-    int id = nextTrip_++;
-    Trip copy = t;
-    copy.id = id;
-    trips_[id] = copy;
+    int id;
+    unsigned long long seq = 0;
+    {
+        std::lock_guard<std::mutex> g(mutex_);
+        id = nextTrip_++;
+        Trip copy = t;
+        copy.id = id;
+        trips_[id] = copy;
+        if (journal_) seq = journal_->append(Journal::Type::TripPut, encode(copy));
+    }
+    if (journal_) journal_->sync(seq);
     return id;
 }
 
 int Store::add_incident(const Incident& inc) {
-    std::lock_guard<std::mutex> g(mutex_);
-    int id = nextIncident_++;
-    Incident copy = inc;
-    copy.id = id;
-    if (copy.timestamp == 0) {
-        copy.timestamp = (long long)std::chrono::system_clock::to_time_t(
-            std::chrono::system_clock::now()
-        );
+    int id;
+    unsigned long long seq = 0;
+    {
+        std::lock_guard<std::mutex> g(mutex_);
+        id = nextIncident_++;
+        Incident copy = inc;
+        copy.id = id;
+        if (copy.timestamp == 0) {
+            copy.timestamp = (long long)std::chrono::system_clock::to_time_t(
+                std::chrono::system_clock::now()
+            );
+        }
+        incidents_[id] = copy;
+        if (journal_) seq = journal_->append(Journal::Type::IncidentPut, encode(copy));
+        record(IncidentDelta::Kind::Added, copy);
+        publish_snapshot();
+        if (copy.expires_at != 0) {
+            expiry_.push({ copy.expires_at, id });
+            arm_expiry(); // moves the timer only if this is the new earliest
+        }
     }
-    incidents_[id] = copy;
+    // the incident is visible before it is durable; callers are answered only after
+    if (journal_) journal_->sync(seq);
     return id;
 }
 
-nlohmann::json Store::list_incidents() {
-    std::lock_guard<std::mutex> g(mutex_);
-    nlohmann::json a = nlohmann::json::array();
-    auto now = (long long)std::chrono::system_clock::to_time_t(
-        std::chrono::system_clock::now()
-    );
-
-    for (auto& kv : incidents_) {
-        const Incident& inc = kv.second;
-        if (inc.expires_at != 0 && inc.expires_at <= now) {
-            // expired: skip (do not erase here, remove_expired() handles cleanup)
-            continue;
+int Store::add_incidents(std::vector<Incident>& batch) {
+    if (batch.empty()) return 0;
+    int first;
+    unsigned long long seq = 0;
+    {
+        std::lock_guard<std::mutex> g(mutex_);
+        first = nextIncident_;
+        long long now = now_epoch();
+        for (auto& inc : batch) {
+            inc.id = nextIncident_++;
+            if (inc.timestamp == 0) inc.timestamp = now;
+            incidents_[inc.id] = inc;
+            if (journal_) seq = journal_->append(Journal::Type::IncidentPut, encode(inc));
+            record(IncidentDelta::Kind::Added, inc);
+            if (inc.expires_at != 0) expiry_.push({ inc.expires_at, inc.id });
         }
-        a.push_back(to_json(inc));
+        publish_snapshot();
+        arm_expiry();
     }
-    return a;
+    if (journal_) journal_->sync(seq);
+    return first;
 }
 
-std::vector<Incident> Store::get_incidents_copy() {
-    std::lock_guard<std::mutex> g(mutex_);
-    std::vector<Incident> out;
-    auto now = (long long)std::chrono::system_clock::to_time_t(
-        std::chrono::system_clock::now()
-    );
-
-    for (auto& kv : incidents_) {
-        const Incident& inc = kv.second;
-        if (inc.expires_at != 0 && inc.expires_at <= now) {
+std::shared_ptr<const IncidentSnapshot> Store::snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+static void append_field(std::string& out, const char* key, long long v) {
+    char buf[24];
+    out += key;
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+
+const std::string& IncidentSnapshot::json() const {
+    // same text as to_json(...).dump() for each element, without building the tree
+    std::call_once(json_once_, [this]() {
+        std::string& out = json_;
+        out.reserve(incidents.size() * 128 + 2);
+        out += '[';
+        for (const auto& inc : incidents) {
+            if (out.size() > 1) out += ',';
+            out += "{\"description\":";
+            bool plain = std::none_of(inc.description.begin(), inc.description.end(),
+                [](char c) { return c == '"' || c == '\\' || (unsigned char)c < 0x20; });
+            if (plain) out.append(1, '"').append(inc.description).append(1, '"');
+            else out += nlohmann::json(inc.description).dump();
+            append_field(out, ",\"expires_at\":", inc.expires_at);
+            append_field(out, ",\"id\":", inc.id);
+            append_field(out, ",\"node_or_edge\":", inc.node_or_edge);
+            append_field(out, ",\"severity\":", inc.severity);
+            append_field(out, ",\"timestamp\":", inc.timestamp);
+            out += '}';
+        }
+        out += ']';
+        });
+    return json_;
+}
+
+void IncidentList::append(std::vector<Incident>&& items) {
+    size_t i = 0;
+    if (!chunks_.empty() && chunks_.back()->size() < kChunk && !items.empty()) {
+        // top up the last chunk (a copy: older snapshots may still share it)
+        auto last = std::make_shared<Chunk>(*chunks_.back());
+        for (; i < items.size() && last->size() < kChunk; ++i) last->push_back(std::move(items[i]));
+        chunks_.back() = std::move(last);
+    }
+    while (i < items.size()) {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->reserve(std::min(kChunk, items.size() - i));
+        for (; i < items.size() && chunk->size() < kChunk; ++i) chunk->push_back(std::move(items[i]));
+        chunks_.push_back(std::move(chunk));
+    }
+    size_ += items.size();
+}
+
+void IncidentList::remove(const std::vector<int>& ids) {
+    if (ids.empty() || chunks_.empty()) return;
+    std::vector<std::shared_ptr<const Chunk>> kept;
+    kept.reserve(chunks_.size());
+    auto id = ids.begin();
+    for (auto& chunk : chunks_) {
+        id = std::lower_bound(id, ids.end(), chunk->front().id);
+        if (id == ids.end() || *id > chunk->back().id) { // untouched: share it
+            kept.push_back(std::move(chunk));
             continue;
         }
-        out.push_back(inc);
+        auto left = std::make_shared<Chunk>();
+        left->reserve(chunk->size());
+        for (const auto& inc : *chunk) {
+            while (id != ids.end() && *id < inc.id) ++id;
+            if (id != ids.end() && *id == inc.id) --size_;
+            else left->push_back(inc);
+        }
+        if (left->empty()) continue;
+        // fold a shrunken chunk into its predecessor so removals do not leave slivers
+        if (!kept.empty() && kept.back()->size() + left->size() <= kChunk) {
+            auto merged = std::make_shared<Chunk>(*kept.back());
+            merged->insert(merged->end(), left->begin(), left->end());
+            kept.back() = std::move(merged);
+        }
+        else kept.push_back(std::move(left));
     }
-    return out;
+    chunks_.swap(kept);
 }
 
-void Store::clear_incidents() {
-    std::lock_guard<std::mutex> g(mutex_);
-    incidents_.clear();
+// Patches the previous snapshot instead of re-sorting incidents_: ids only grow, so
+// additions append in order and removals rewrite only the chunks they hit. JSON is
+// left to the first reader.
+void Store::publish_snapshot() {
+    auto s = std::make_shared<IncidentSnapshot>();
+    s->version = incidentsVersion_;
+    if (republish_all_) {
+        std::vector<Incident> all;
+        all.reserve(incidents_.size());
+        for (const auto& kv : incidents_) all.push_back(kv.second);
+        std::sort(all.begin(), all.end(), [](const Incident& a, const Incident& b) { return a.id < b.id; });
+        s->incidents.append(std::move(all));
+    }
+    else {
+        s->incidents = snapshot_->incidents; // chunk pointers only
+        std::sort(unpublished_removed_.begin(), unpublished_removed_.end());
+        // an incident added and removed since the last publish never shows up
+        auto removed = [this](int id) {
+            return std::binary_search(unpublished_removed_.begin(), unpublished_removed_.end(), id);
+        };
+        s->incidents.remove(unpublished_removed_);
+        unpublished_added_.erase(std::remove_if(unpublished_added_.begin(), unpublished_added_.end(),
+            [&](const Incident& inc) { return removed(inc.id); }), unpublished_added_.end());
+        s->incidents.append(std::move(unpublished_added_));
+    }
+    unpublished_added_.clear();
+    unpublished_removed_.clear();
+    republish_all_ = false;
+    std::atomic_store(&snapshot_, std::shared_ptr<const IncidentSnapshot>(std::move(s)));
+    for (const auto& fn : change_listeners_) fn();
 }
 
-void Store::remove_expired() {
+void Store::on_change(std::function<void()> fn) {
     std::lock_guard<std::mutex> g(mutex_);
-    auto now = (long long)std::chrono::system_clock::to_time_t(
-        std::chrono::system_clock::now()
-    );
+    change_listeners_.push_back(std::move(fn));
+}
 
-    for (auto it = incidents_.begin(); it != incidents_.end(); ) {
-        if (it->second.expires_at != 0 && it->second.expires_at <= now) {
-            it = incidents_.erase(it);
+void Store::clear_incidents() {
+    unsigned long long seq = 0;
+    {
+        std::lock_guard<std::mutex> g(mutex_);
+        if (incidents_.empty()) return;
+        for (const auto& kv : incidents_) {
+            record(IncidentDelta::Kind::Expired, kv.second);
+            if (journal_) seq = journal_->append(Journal::Type::IncidentRemove, Journal::Encoder().i32(kv.first));
         }
-        else {
-            ++it;
+        incidents_.clear();
+        expiry_ = {};
+        publish_snapshot();
+        arm_expiry();
+    }
+    if (journal_) journal_->sync(seq);
+}
+
+unsigned long long Store::incidents_version() {
+    return snapshot()->version;
+}
+
+size_t Store::purge_expired(long long now) {
+    size_t purged = 0;
+    while (!expiry_.empty() && expiry_.top().first <= now) {
+        Expiry e = expiry_.top();
+        expiry_.pop();
+        auto it = incidents_.find(e.second);
+        if (it == incidents_.end() || it->second.expires_at != e.first) continue; // already gone
+        record(IncidentDelta::Kind::Expired, it->second);
+        if (journal_) journal_->append(Journal::Type::IncidentRemove, Journal::Encoder().i32(it->first));
+        incidents_.erase(it);
+        ++purged;
+    }
+    if (purged) publish_snapshot();
+    return purged;
+}
+
+void Store::start_expiry(Scheduler& scheduler, std::function<void()> on_expired) {
+    std::lock_guard<std::mutex> g(mutex_);
+    on_expired_ = std::move(on_expired);
+    scheduler_ = &scheduler;
+    arm_expiry();
+}
+
+void Store::arm_expiry() {
+    if (!scheduler_) return;
+    long long due = expiry_.empty() ? 0 : expiry_.top().first;
+    if (due == expiry_armed_) return;
+    if (expiry_job_) scheduler_->cancel(expiry_job_);
+    expiry_job_ = 0;
+    expiry_armed_ = due;
+    if (due == 0) return;
+    // expires_at is in whole seconds: the incident lapses when that second begins
+    auto delay = std::chrono::system_clock::from_time_t((time_t)due) - std::chrono::system_clock::now();
+    unsigned long long generation = ++expiry_generation_;
+    expiry_job_ = scheduler_->after(
+        std::chrono::duration_cast<Scheduler::Clock::duration>(std::max(delay, decltype(delay)::zero())),
+        [this, generation]() { on_expiry_timer(generation); });
+}
+
+void Store::on_expiry_timer(unsigned long long generation) {
+    size_t purged;
+    {
+        std::lock_guard<std::mutex> g(mutex_);
+        if (generation == expiry_generation_) {
+            expiry_job_ = 0;
+            expiry_armed_ = 0;
         }
+        purged = purge_expired(now_epoch());
+        arm_expiry();
+    }
+    if (purged && on_expired_) on_expired_(); // the scheduler logs exceptions
+}
+
+void Store::record(IncidentDelta::Kind kind, const Incident& inc) {
+    IncidentDelta d;
+    d.kind = kind;
+    d.version = ++incidentsVersion_;
+    d.incident = inc;
+    if (kind == IncidentDelta::Kind::Added) unpublished_added_.push_back(inc);
+    else unpublished_removed_.push_back(inc.id);
+    deltas_.push_back(std::move(d));
+    if (deltas_.size() > kMaxIncidentDeltas) deltas_.pop_front();
+}
+
+bool Store::incident_deltas(unsigned long long since, std::vector<IncidentDelta>& out) {
+    std::lock_guard<std::mutex> g(mutex_);
+    if (since >= incidentsVersion_) return since == incidentsVersion_;
+    if (deltas_.empty() || deltas_.front().version > since + 1) return false;
+    for (auto it = deltas_.end() - (incidentsVersion_ - since); it != deltas_.end(); ++it) out.push_back(*it);
+    return true;
+}
+
+void Store::attach_journal(Journal* journal) {
+    std::lock_guard<std::mutex> g(mutex_);
+    journal_ = journal;
+}
+
+bool Store::replay(Journal::Type type, Journal::Decoder& d) {
+    std::lock_guard<std::mutex> g(mutex_);
+    switch (type) {
+    case Journal::Type::IncidentPut: {
+        Incident inc;
+        inc.id = d.i32();
+        inc.node_or_edge = d.i32();
+        inc.severity = d.i32();
+        inc.timestamp = d.i64();
+        inc.expires_at = d.i64();
+        inc.description = d.str();
+        if (!d.ok()) return true;
+        nextIncident_ = std::max(nextIncident_, inc.id + 1);
+        incidents_[inc.id] = std::move(inc);
+        return true;
     }
+    case Journal::Type::IncidentRemove: {
+        int id = d.i32();
+        if (d.ok()) incidents_.erase(id);
+        return true;
+    }
+    case Journal::Type::TripPut: {
+        Trip t;
+        t.id = d.i32();
+        t.src = d.i32();
+        t.dst = d.i32();
+        t.start_time = d.i64();
+        t.active = d.i32() != 0;
+        t.user = d.str();
+        if (!d.ok()) return true;
+        nextTrip_ = std::max(nextTrip_, t.id + 1);
+        trips_[t.id] = std::move(t);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void Store::capture(const Journal::PutFn& put) {
+    std::lock_guard<std::mutex> g(mutex_);
+    for (const auto& kv : trips_) put(Journal::Type::TripPut, encode(kv.second));
+    for (const auto& kv : incidents_) put(Journal::Type::IncidentPut, encode(kv.second));
 }
 
+// Recovered incidents start a fresh delta history (one version step with no deltas),
+// so SSE clients resync from the keyframe and the penalty overlay is rebuilt.
+void Store::finish_replay() {
+    std::lock_guard<std::mutex> g(mutex_);
+    ++incidentsVersion_;
+    deltas_.clear();
+    republish_all_ = true;
+    expiry_ = {};
+    for (const auto& kv : incidents_)
+        if (kv.second.expires_at != 0) expiry_.push({ kv.second.expires_at, kv.first });
+    publish_snapshot();
+    arm_expiry();
+}
@@ -1,10 +1,18 @@
 #pragma once
+#include <deque>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <queue>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include "json.hpp"
 #include "dijkstra.hpp"
+#include "journal.hpp"
+#include "scheduler.hpp"
 
 struct Trip {
     int id = 0;
@@ -27,28 +35,151 @@ struct Incident {
 // Helper for consistent JSON conversion
 nlohmann::json to_json(const Incident& inc);
 
+// One change to the incident set. Every change bumps incidents_version() by one,
+// so consecutive deltas have consecutive versions.
+struct IncidentDelta {
+    enum class Kind { Added, Expired }; // Expired also covers clear_incidents()
+    Kind kind = Kind::Added;
+    unsigned long long version = 0;     // incidents_version() right after this change
+    Incident incident;                  // as added / as it was when removed
+};
+
+// Incidents ordered by id, kept in chunks of at most kChunk that consecutive snapshots
+// share. A change copies the chunks it touches plus the table of chunk pointers, so a
+// single add costs O(kChunk + n / kChunk) rather than a copy of every incident.
+class IncidentList {
+public:
+    static constexpr size_t kChunk = 256;
+    using Chunk = std::vector<Incident>;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Incident;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Incident*;
+        using reference = const Incident&;
+
+        const_iterator() = default;
+        reference operator*() const { return (*(*chunks_)[chunk_])[item_]; }
+        pointer operator->() const { return &**this; }
+        const_iterator& operator++() {
+            if (++item_ == (*chunks_)[chunk_]->size()) { ++chunk_; item_ = 0; }
+            return *this;
+        }
+        bool operator==(const const_iterator& o) const { return chunk_ == o.chunk_ && item_ == o.item_; }
+        bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+    private:
+        friend class IncidentList;
+        const_iterator(const std::vector<std::shared_ptr<const Chunk>>* chunks, size_t chunk)
+            : chunks_(chunks), chunk_(chunk) {}
+        const std::vector<std::shared_ptr<const Chunk>>* chunks_ = nullptr;
+        size_t chunk_ = 0;
+        size_t item_ = 0;
+    };
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Incident& front() const { return chunks_.front()->front(); }
+    const_iterator begin() const { return const_iterator(&chunks_, 0); }
+    const_iterator end() const { return const_iterator(&chunks_, chunks_.size()); }
+
+    // `items` must have ids above every id in the list, ascending.
+    void append(std::vector<Incident>&& items);
+    // `ids` sorted ascending; ids not in the list are ignored.
+    void remove(const std::vector<int>& ids);
+
+private:
+    std::vector<std::shared_ptr<const Chunk>> chunks_; // none empty
+    size_t size_ = 0;
+};
+
+// Immutable view of the incident set. The store publishes a new one after every change;
+// readers share it without locking or copying.
+struct IncidentSnapshot {
+    unsigned long long version = 0;      // incidents_version() it reflects
+    IncidentList incidents;              // ordered by id
+
+    // `incidents` serialized as a JSON array; built by the first caller, then shared.
+    const std::string& json() const;
+
+private:
+    mutable std::once_flag json_once_;
+    mutable std::string json_;
+};
+
 class Store {
 public:
     Store();
     int add_trip(const Trip& t);
     int add_incident(const Incident& inc);
 
-    // Returns only active (non-expired) incidents as JSON array (by value, thread-safe).
-    nlohmann::json list_incidents();
+    // Adds the whole batch under one lock: consecutive ids (written back into `batch`),
+    // one published snapshot, one journal sync. Returns the first id (0 if empty).
+    int add_incidents(std::vector<Incident>& batch);
 
-    // Returns safe vector copy of active incidents.
-    std::vector<Incident> get_incidents_copy();
+    // Current incident set; lock-free (atomic shared_ptr load). Lapsed incidents are
+    // removed by the expiry timer, so readers never look at the clock.
+    std::shared_ptr<const IncidentSnapshot> snapshot() const;
 
-    // Purges expired incidents from storage (thread-safe).
-    void remove_expired();
+    // Keeps one scheduler job armed for the earliest expires_at (none while nothing
+    // expires); it purges and runs `on_expired` after each purge that removed something.
+    void start_expiry(Scheduler& scheduler, std::function<void()> on_expired);
 
     // remove everything (admin/demo helper)
     void clear_incidents();
 
+    // Persistence. Once attached, every trip / incident change is appended to the
+    // journal under mutex_; add_trip / add_incident / clear_incidents return only after
+    // their records are durable, and throw (with the change applied in memory only) if
+    // the journal failed. Expiry purges are not waited for: replaying an
+    // incident that has lapsed just expires it again.
+    void attach_journal(Journal* journal);
+    bool replay(Journal::Type type, Journal::Decoder& d); // false: not a store record
+    void capture(const Journal::PutFn& put);              // current trips and incidents
+    void finish_replay();                                 // rebuild expiry heap and snapshot
+
+    // Registers `fn` to run after every newly published snapshot. It runs with the store
+    // lock held, so it must only signal (set a flag, notify) and never call back in.
+    void on_change(std::function<void()> fn);
+
+    // Bumped once per incident added, cleared or purged. Lock-free.
+    unsigned long long incidents_version();
+
+    // Appends the changes after `since` (oldest first). Returns false if the log no longer
+    // reaches back that far; the caller should resync from incidents_snapshot().
+    bool incident_deltas(unsigned long long since, std::vector<IncidentDelta>& out);
+
 private:
+    // expect mutex_ to be held
+    void record(IncidentDelta::Kind kind, const Incident& inc);
+    void publish_snapshot(); // applies the changes recorded since the last one
+    size_t purge_expired(long long now);
+
+    void arm_expiry();                          // expects mutex_ to be held
+    void on_expiry_timer(unsigned long long generation);
+
+    using Expiry = std::pair<long long, int>; // (expires_at, incident id)
+
     std::mutex mutex_;
+    // min-heap on expires_at; entries of incidents already removed are skipped when popped
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiry_;
+    std::function<void()> on_expired_;
+    Scheduler* scheduler_ = nullptr;
+    Scheduler::JobId expiry_job_ = 0;
+    long long expiry_armed_ = 0;                // expires_at expiry_job_ fires for, 0 = none
+    unsigned long long expiry_generation_ = 0;  // tells a stale timer from the armed one
+    unsigned long long incidentsVersion_;
+    std::deque<IncidentDelta> deltas_;   // the most recent changes, bounded
+    std::vector<Incident> unpublished_added_;  // recorded since the last publish_snapshot()
+    std::vector<int> unpublished_removed_;
+    bool republish_all_ = false;         // replay filled incidents_ without recording
     int nextTrip_;
     int nextIncident_;
     std::unordered_map<int, Trip> trips_;
     std::unordered_map<int, Incident> incidents_;
+    std::shared_ptr<const IncidentSnapshot> snapshot_; // std::atomic_load / atomic_store only
+    Journal* journal_ = nullptr;
+    std::vector<std::function<void()>> change_listeners_;
 };
@@ -0,0 +1,117 @@
+#include "subscription.hpp"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(sep, start);
+        if (end == std::string::npos) end = s.size();
+        if (end > start) out.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return out;
+}
+
+static int to_int(const std::string& s) {
+    size_t used = 0;
+    int v = std::stoi(s, &used);
+    if (used != s.size()) throw std::invalid_argument("bad number: " + s);
+    return v;
+}
+
+// %XX and '+' as in application/x-www-form-urlencoded; a stray '%' is kept as is
+static std::string url_decode(const std::string& s) {
+    auto hex = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '+') out += ' ';
+        else if (s[i] == '%' && i + 2 < s.size() && hex(s[i + 1]) >= 0 && hex(s[i + 2]) >= 0) {
+            out += (char)(hex(s[i + 1]) * 16 + hex(s[i + 2]));
+            i += 2;
+        }
+        else out += s[i];
+    }
+    return out;
+}
+
+Subscription Subscription::parse(const std::string& query) {
+    Subscription sub;
+    std::string q = query;
+    if (!q.empty() && q[0] == '?') q.erase(0, 1);
+    for (const auto& raw : split(q, '&')) {
+        // decoded before splitting on '=', so "severity%3E%3D2" reads as "severity>=2"
+        std::string param = url_decode(raw);
+        size_t eq = param.find('=');
+        std::string key = param.substr(0, eq);
+        std::string value = eq == std::string::npos ? std::string() : param.substr(eq + 1);
+        if (key == "types") {
+            sub.topics = 0;
+            for (const auto& t : split(value, ',')) {
+                if (t == "incidents") sub.topics |= EventTags::Incidents;
+                else if (t == "dna") sub.topics |= EventTags::Dna;
+                else if (t == "monitors") sub.topics |= EventTags::Monitors;
+                else throw std::invalid_argument("unknown type: " + t);
+            }
+        }
+        else if (key == "severity>" || key == "severity") {
+            sub.min_severity = to_int(value);
+        }
+        else if (key == "nodes") {
+            for (const auto& r : split(value, ',')) {
+                size_t dash = r.find('-', 1);
+                int lo = to_int(r.substr(0, dash));
+                int hi = dash == std::string::npos ? lo : to_int(r.substr(dash + 1));
+                if (hi < lo) std::swap(lo, hi);
+                sub.nodes.push_back({ lo, hi });
+            }
+        }
+        else if (key == "monitors") {
+            for (const auto& m : split(value, ',')) sub.monitors.push_back(to_int(m));
+        }
+    }
+    // merge overlapping ranges so a lookup is one binary search
+    std::sort(sub.nodes.begin(), sub.nodes.end());
+    std::vector<std::pair<int, int>> merged;
+    for (const auto& r : sub.nodes) {
+        if (!merged.empty() && r.first <= merged.back().second + 1) merged.back().second = std::max(merged.back().second, r.second);
+        else merged.push_back(r);
+    }
+    sub.nodes.swap(merged);
+    std::sort(sub.monitors.begin(), sub.monitors.end());
+    sub.monitors.erase(std::unique(sub.monitors.begin(), sub.monitors.end()), sub.monitors.end());
+    return sub;
+}
+
+bool Subscription::matches(const EventTags& tags) const {
+    if (!(topics & tags.topic)) return false;
+    if (tags.topic == EventTags::Incidents && tags.node >= 0) {
+        if (tags.severity < min_severity) return false;
+        if (!nodes.empty()) {
+            // last range starting at or before the node
+            auto it = std::upper_bound(nodes.begin(), nodes.end(), std::make_pair(tags.node, std::numeric_limits<int>::max()));
+            if (it == nodes.begin() || tags.node > std::prev(it)->second) return false;
+        }
+    }
+    if (tags.topic == EventTags::Monitors && tags.monitor_id >= 0 && !monitors.empty())
+        return std::binary_search(monitors.begin(), monitors.end(), tags.monitor_id);
+    return true;
+}
+
+std::string Subscription::key() const {
+    std::string k;
+    if (topics != EventTags::All) k += "t" + std::to_string(topics);
+    if (min_severity > 0) k += "s" + std::to_string(min_severity);
+    for (const auto& r : nodes) k += "n" + std::to_string(r.first) + "-" + std::to_string(r.second);
+    for (int m : monitors) k += "m" + std::to_string(m);
+    return k;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+// What an /events frame is about, so subscribers can filter it without parsing.
+struct EventTags {
+    enum Topic : unsigned { Incidents = 1, Dna = 2, Monitors = 4, All = 7 };
+    unsigned topic = All;
+    int node = -1;        // incident location, -1 = not about one incident
+    int severity = 0;     // incident severity (only looked at when node >= 0)
+    int monitor_id = -1;  // monitor an alert belongs to, -1 = none
+};
+
+// One client's filter, parsed from the /events query string, e.g.
+//   ?types=incidents,dna&nodes=10-200,305&severity>=2&monitors=3,7
+// Keys and values may be percent-encoded (severity%3E=2, nodes=1-5%2C9).
+// Omitted keys match everything. Unknown keys are ignored; malformed values throw.
+// A filtered incident stream skips the versions of incidents it does not match, so
+// gaps there are not lost updates.
+struct Subscription {
+    unsigned topics = EventTags::All;
+    int min_severity = 0;
+    std::vector<std::pair<int, int>> nodes; // inclusive ranges, sorted; empty = every node
+    std::vector<int> monitors;              // sorted; empty = every monitor
+
+    static Subscription parse(const std::string& query);
+
+    bool matches(const EventTags& tags) const;
+
+    // Canonical form; subscriptions with equal keys filter identically.
+    std::string key() const;
+};
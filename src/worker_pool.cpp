@@ -0,0 +1,100 @@
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <iostream>
+
+WorkerPool::WorkerPool(size_t threads) : size_(threads ? threads : 1) {}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void WorkerPool::start() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    start_locked();
+}
+
+void WorkerPool::start_locked() {
+    if (threads_.empty())
+        for (size_t i = 0; i < size_; ++i) threads_.emplace_back([this]() { run(); });
+}
+
+void WorkerPool::submit(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        queue_.push_back(std::move(fn));
+        start_locked();
+    }
+    cv_.notify_one();
+}
+
+void WorkerPool::parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+    size_t helpers = std::min(size_, count > 0 ? count - 1 : 0);
+    if (helpers == 0) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+    // Helpers that start after every index is taken return without touching fn, so the
+    // shared state outlives this call but fn need not.
+    struct Shared {
+        std::atomic<size_t> next{ 0 };
+        size_t finished = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto shared = std::make_shared<Shared>();
+    auto work = [shared, count, &fn]() {
+        size_t ran = 0;
+        std::exception_ptr error;
+        for (size_t i = shared->next++; i < count; i = shared->next++) {
+            try {
+                fn(i);
+            }
+            catch (...) {
+                if (!error) error = std::current_exception();
+            }
+            ++ran;
+        }
+        if (ran == 0) return;
+        std::lock_guard<std::mutex> lk(shared->mutex);
+        if (error && !shared->error) shared->error = error;
+        shared->finished += ran;
+        if (shared->finished == count) shared->done.notify_all();
+    };
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        for (size_t h = 0; h < helpers; ++h) queue_.push_back(work);
+        start_locked();
+    }
+    cv_.notify_all();
+    work();
+    std::unique_lock<std::mutex> lk(shared->mutex);
+    shared->done.wait(lk, [&] { return shared->finished == count; });
+    if (shared->error) std::rethrow_exception(shared->error);
+}
+
+void WorkerPool::run() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (;;) {
+        cv_.wait(lk, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return; // stopping, nothing left
+        std::function<void()> fn = std::move(queue_.front());
+        queue_.pop_front();
+        lk.unlock();
+        try {
+            fn();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[worker] task threw: " << e.what() << "\n";
+        }
+        lk.lock();
+    }
+}
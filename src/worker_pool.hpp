@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads fed from one FIFO queue, for work that must not run on the
+// thread that produced it (e.g. scheduler jobs that write to the journal) and for
+// splitting one request across cores. The threads start with start() or the first task
+// and live until the pool is destroyed, so thread_local state (search workspaces) is
+// reused across requests.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads = 1);
+    ~WorkerPool(); // runs the queued tasks, then joins
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void start();
+
+    // Queues fn; a task that throws is logged and dropped.
+    void submit(std::function<void()> fn);
+
+    // Runs fn(0) .. fn(count-1) on the calling thread and the pool, returning when all
+    // have finished. The caller takes indices too, so a busy pool only makes it slower,
+    // never stuck. The first exception fn throws is rethrown here.
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t size() const { return size_; }
+
+private:
+    void run();
+    void start_locked(); // mutex_ held
+
+    size_t size_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,86 @@
+// Timer heap order, lazy cancellation, recurring jobs and the lateness stats.
+#include "scheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static int failures = 0;
+
+static void expect(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+// polls `done` for up to a second
+template <typename Pred>
+static bool eventually(Pred done) {
+    for (int i = 0; i < 200 && !done(); ++i) std::this_thread::sleep_for(5ms);
+    return done();
+}
+
+int main() {
+    Scheduler s;
+    std::mutex mutex;
+    std::vector<int> order;
+    auto log = [&](int v) { return [&, v]() { std::lock_guard<std::mutex> lk(mutex); order.push_back(v); }; };
+    auto ran = [&]() { std::lock_guard<std::mutex> lk(mutex); return order; };
+
+    // due order, not insertion order; a later-added earlier job wakes the timer early
+    s.after(60ms, log(3));
+    s.after(40ms, log(2));
+    auto cancelled = s.after(50ms, log(99));
+    s.after(20ms, log(1));
+    expect(s.cancel(cancelled), "cancel a pending job");
+    expect(!s.cancel(cancelled), "cancel twice");
+    expect(eventually([&] { return ran().size() == 3; }), "three jobs fired");
+    std::this_thread::sleep_for(30ms);
+    expect(ran() == std::vector<int>({ 1, 2, 3 }), "fired in due order, cancelled one skipped");
+
+    // a fired one-shot cannot be cancelled any more
+    auto fired = s.after(0ms, log(4));
+    expect(eventually([&] { return ran().size() == 4; }), "immediate job fired");
+    expect(!s.cancel(fired), "cancel after fire returns false");
+
+    // jobs run without the scheduler lock: they may schedule and cancel
+    std::atomic<bool> nested{ false };
+    s.after(0ms, [&]() {
+        auto id = s.after(1h, [] {});
+        bool c = s.cancel(id);
+        s.after(0ms, [&, c]() { nested = c; });
+    });
+    expect(eventually([&] { return nested.load(); }), "job scheduled and cancelled from a job");
+
+    // recurring job repeats until cancelled
+    std::atomic<int> ticks{ 0 };
+    auto every = s.every(5ms, [&]() { ++ticks; });
+    expect(eventually([&] { return ticks.load() >= 3; }), "recurring job repeats");
+    expect(s.cancel(every), "cancel a recurring job");
+    int after_cancel = ticks.load();
+    std::this_thread::sleep_for(30ms);
+    expect(ticks.load() <= after_cancel + 1, "recurring job stops after cancel"); // one may be running
+
+    // a blocking job makes the next one late, and stats() shows it
+    Scheduler::Stats before = s.stats();
+    s.after(0ms, [] { std::this_thread::sleep_for(50ms); });
+    std::atomic<bool> late_ran{ false };
+    s.after(10ms, [&]() { late_ran = true; });
+    expect(eventually([&] { return late_ran.load(); }), "job behind a blocker ran");
+    Scheduler::Stats st = s.stats();
+    expect(st.executed == before.executed + 2, "executed counts every run");
+    expect(st.cancelled >= 3, "cancelled counts pending cancels");
+    expect(st.last_lateness_us >= 30000, "lateness of the blocked job recorded");
+    expect(st.max_lateness_us >= st.last_lateness_us && st.avg_lateness_us >= 0, "max / avg lateness");
+    expect(st.queued == 0, "nothing left queued");
+
+    s.after(1h, [] {});
+    expect(s.stats().queued == 1, "queued counts pending jobs");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+// Snapshot publishing must stay cheap per write: N single adds are timed against a
+// generous bound that a copy-everything publish (O(N^2) overall) cannot meet.
+#include "store.hpp"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+static bool ordered(const IncidentSnapshot& snap) {
+    int last = 0;
+    size_t count = 0;
+    for (const auto& inc : snap.incidents) {
+        if (inc.id <= last) return false;
+        last = inc.id;
+        ++count;
+    }
+    return count == snap.incidents.size();
+}
+
+int main() {
+    const int kAdds = 50000;
+    Store store;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < kAdds; ++i) {
+        Incident inc;
+        inc.node_or_edge = i % 100;
+        inc.description = "single add";
+        store.add_incident(inc);
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << kAdds << " single adds in " << ms << " ms\n";
+    expect(ms < 5000, "single adds stay cheap");
+
+    auto before = store.snapshot();
+    expect(before->incidents.size() == (size_t)kAdds, "every add published");
+    expect(ordered(*before), "snapshot ordered by id");
+
+    // every third incident of a batch lapses at once; the expiry timer removes them
+    long long now = (long long)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::vector<Incident> batch(3000);
+    for (size_t i = 0; i < batch.size(); ++i) batch[i].expires_at = i % 3 == 0 ? now - 1 : 0;
+    store.add_incidents(batch);
+    Scheduler scheduler;
+    store.start_expiry(scheduler, nullptr);
+    for (int i = 0; i < 200 && store.snapshot()->incidents.size() != (size_t)kAdds + 2000; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto after = store.snapshot();
+    expect(after->incidents.size() == (size_t)kAdds + 2000, "lapsed incidents removed");
+    expect(ordered(*after), "ordered after removals");
+    bool kept = true;
+    for (const auto& inc : after->incidents) kept = kept && inc.expires_at == 0;
+    expect(kept, "only lapsed incidents removed");
+    expect(before->incidents.size() == (size_t)kAdds && ordered(*before), "older snapshot unchanged");
+
+    store.clear_incidents();
+    expect(store.snapshot()->incidents.empty(), "clear empties the snapshot");
+    return failures ? 1 : 0;
+}
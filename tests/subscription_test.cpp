@@ -0,0 +1,43 @@
+// /events filters arrive percent-encoded from most HTTP clients; they must parse the
+// same as the plain form.
+#include "subscription.hpp"
+#include <iostream>
+#include <stdexcept>
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+int main() {
+    Subscription plain = Subscription::parse("types=incidents&nodes=1-5,9&severity>=2&monitors=3,7");
+    expect(plain.min_severity == 2, "plain severity");
+    expect(plain.nodes.size() == 2, "plain node ranges");
+
+    const char* encoded[] = {
+        "?types=incidents&nodes=1-5%2C9&severity%3E=2&monitors=3%2c7",
+        "types%3Dincidents&nodes%3D1-5%2C9&severity%3E%3D2&monitors%3D3%2C7",
+    };
+    for (const char* q : encoded) {
+        Subscription sub = Subscription::parse(q);
+        expect(sub.key() == plain.key(), q);
+    }
+
+    EventTags tags;
+    tags.topic = EventTags::Incidents;
+    tags.node = 9;
+    tags.severity = 2;
+    expect(Subscription::parse("nodes=1-5%2C9&severity%3E=2").matches(tags), "encoded filter matches");
+    tags.severity = 1;
+    expect(!Subscription::parse("nodes=1-5%2C9&severity%3E=2").matches(tags), "encoded severity filters");
+
+    bool threw = false;
+    try { Subscription::parse("nodes=5%2"); }
+    catch (const std::exception&) { threw = true; }
+    expect(threw, "truncated escape is not a number");
+    return failures ? 1 : 0;
+}